@@ -1,33 +1,119 @@
 namespace Atom {
 
 class Application : Gtk.Application {
+  private const OptionEntry[] OPTIONS = {
+    {"background", 'b', OptionFlags.NONE, OptionArg.NONE, null, "Start in the background without opening a window", null},
+    {null}
+  };
+
+  private static int64 start_time;
+  private bool background = false;
+  private string[] recoverable_files = {};
+
   public Application() {
     Object(application_id: "com.github.eyelash.atom-gtk", flags: ApplicationFlags.HANDLES_OPEN);
+    add_main_option_entries(OPTIONS);
+  }
+
+  public override int handle_local_options(VariantDict options) {
+    if (options.contains("background")) {
+      try {
+        register();
+      } catch (Error e) {
+        printerr("%s\n", e.message);
+        return 1;
+      }
+      // an instance is already running, there is nothing left to warm up
+      if (get_is_remote()) {
+        return 0;
+      }
+      background = true;
+    }
+    return -1;
   }
 
   public override void startup() {
     base.startup();
+    // the primary instance is the only one writing journals, so any journal found now was left behind by a crash.
+    // the files are reopened with the first window and replay their journals
+    recoverable_files = Atom.TextEditorWidget.get_recoverable_files();
     Gtk.Settings.get_default().gtk_application_prefer_dark_theme = true;
     load_css("/com/github/eyelash/atom-gtk/one-dark.css");
     set_accels_for_action("win.new-file", {"<Primary>N"});
     set_accels_for_action("win.open", {"<Primary>O"});
     set_accels_for_action("win.save", {"<Primary>S"});
     set_accels_for_action("win.save-as", {"<Primary><Shift>S"});
-    var window = new Window(this);
-    window.show_all();
-    window.present();
+    set_accels_for_action("win.find", {"<Primary>F"});
+    set_accels_for_action("win.find-in-files", {"<Primary><Shift>F"});
+    set_accels_for_action("win.fuzzy-finder", {"<Primary>P"});
+    set_accels_for_action("win.toggle-soft-wrap", {"<Alt>Z"});
+  }
+
+  // windows that are still open when the application quits keep their tabs for the next start
+  public override void shutdown() {
+    foreach (unowned Gtk.Window window in get_windows()) {
+      var atom_window = window as Atom.Window;
+      if (atom_window != null) {
+        atom_window.save_session();
+      }
+    }
+    base.shutdown();
   }
 
   public override void activate() {
-    var window = get_active_window() as unowned Atom.Window;
-    window.append_tab();
+    if (background) {
+      // stay alive without a window, later launches only hand their files over and show a window
+      background = false;
+      Atom.TextEditorWidget.warm_up();
+      hold();
+      debug("warmed up %.1f ms after process start", (get_monotonic_time() - start_time) / 1000.0);
+      return;
+    }
+    var window = get_active_window() as Atom.Window;
+    if (window == null) {
+      window = create_window();
+      // a new window starts with the tabs of the last session
+      bool restored = window.restore_session();
+      if (!recover_files(window) && !restored) {
+        window.append_tab();
+      }
+    } else {
+      window.append_tab();
+    }
+    window.present();
   }
 
   public override void open(File[] files, string hint) {
-    var window = get_active_window() as unowned Atom.Window;
+    var window = get_active_window() as Atom.Window;
+    if (window == null) {
+      window = create_window();
+      window.restore_session();
+      recover_files(window);
+    }
     foreach (var file in files) {
       window.append_tab(file);
     }
+    window.present();
+  }
+
+  private bool recover_files(Atom.Window window) {
+    bool recovered = window.recover_files(recoverable_files);
+    recoverable_files = {};
+    return recovered;
+  }
+
+  private Atom.Window create_window() {
+    int64 request_time = get_monotonic_time();
+    var window = new Window(this);
+    ulong handler_id = 0;
+    handler_id = window.draw.connect_after(() => {
+      window.disconnect(handler_id);
+      int64 now = get_monotonic_time();
+      debug("first frame %.1f ms after the request, %.1f ms after process start", (now - request_time) / 1000.0, (now - start_time) / 1000.0);
+      return false;
+    });
+    window.show_all();
+    return window;
   }
 
   private void load_css(string resource_path) {
@@ -37,6 +123,7 @@ class Application : Gtk.Application {
   }
 
   public static int main(string[] args) {
+    start_time = get_monotonic_time();
     return new Application().run(args);
   }
 }
@@ -0,0 +1,199 @@
+#include "bracket-index.h"
+#include <algorithm>
+
+// rows per block, blocks are split again once they grow past twice this many
+#define BLOCK_SIZE 256
+
+static const char16_t OPENING_BRACKETS[] = u"([{";
+static const char16_t CLOSING_BRACKETS[] = u")]}";
+
+// the kind of bracket, or -1, and whether it opens
+static int get_kind(char16_t c, bool &opening) {
+  for (int kind = 0; kind < 3; kind++) {
+    if (c == OPENING_BRACKETS[kind] || c == CLOSING_BRACKETS[kind]) {
+      opening = c == OPENING_BRACKETS[kind];
+      return kind;
+    }
+  }
+  return -1;
+}
+
+BracketIndex::BracketIndex() : row_count(0) {}
+
+size_t BracketIndex::get_row_count() const {
+  return row_count;
+}
+
+void BracketIndex::update_block_starts() {
+  block_starts.resize(blocks.size());
+  size_t row = 0;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    block_starts[i] = row;
+    row += blocks[i].rows.size();
+  }
+  row_count = row;
+}
+
+size_t BracketIndex::find_block(size_t row) const {
+  return std::upper_bound(block_starts.begin(), block_starts.end(), row) - block_starts.begin() - 1;
+}
+
+const BracketIndex::Block &BracketIndex::get_block(size_t index) {
+  Block &block = blocks[index];
+  if (!block.stale) return block;
+  for (int kind = 0; kind < 3; kind++) {
+    int32_t sum = 0;
+    int32_t min_prefix = 0;
+    for (const Row &row : block.rows) {
+      for (const Bracket &bracket : row.brackets) {
+        bool opening;
+        if (get_kind(bracket.character, opening) != kind) continue;
+        sum += opening ? 1 : -1;
+        min_prefix = std::min(min_prefix, sum);
+      }
+    }
+    // the highest suffix is the sum minus the lowest prefix before it
+    int32_t max_suffix = 0;
+    int32_t prefix = 0;
+    for (const Row &row : block.rows) {
+      for (const Bracket &bracket : row.brackets) {
+        bool opening;
+        if (get_kind(bracket.character, opening) != kind) continue;
+        prefix += opening ? 1 : -1;
+        max_suffix = std::max(max_suffix, sum - prefix);
+      }
+    }
+    max_suffix = std::max(max_suffix, sum);
+    block.sum[kind] = sum;
+    block.min_prefix[kind] = min_prefix;
+    block.max_suffix[kind] = max_suffix;
+  }
+  block.stale = false;
+  return block;
+}
+
+void BracketIndex::splice(size_t row, size_t old_count, size_t new_count) {
+  old_count = std::min(old_count, row_count - std::min(row, row_count));
+  if (old_count == 0 && new_count == 0) return;
+  // the rows of the blocks that are touched, without the replaced ones
+  size_t first_block = blocks.size();
+  size_t last_block = blocks.size();
+  std::vector<Row> rows;
+  if (!blocks.empty()) {
+    first_block = find_block(std::min(row, row_count - 1));
+    last_block = old_count > 0 ? find_block(row + old_count - 1) : first_block;
+    std::vector<Row> &first_rows = blocks[first_block].rows;
+    std::vector<Row> &last_rows = blocks[last_block].rows;
+    const size_t start = row - block_starts[first_block];
+    const size_t end = row + old_count - block_starts[last_block];
+    rows.reserve(start + new_count + last_rows.size() - std::min(end, last_rows.size()));
+    std::move(first_rows.begin(), first_rows.begin() + start, std::back_inserter(rows));
+    rows.resize(rows.size() + new_count, Row{{}, false});
+    if (end < last_rows.size()) {
+      std::move(last_rows.begin() + end, last_rows.end(), std::back_inserter(rows));
+    }
+    last_block++;
+  } else {
+    rows.resize(new_count, Row{{}, false});
+    first_block = last_block = 0;
+  }
+  std::vector<Block> new_blocks;
+  size_t start = 0;
+  while (start < rows.size()) {
+    // a short remainder stays with the block before it
+    const size_t end = rows.size() - start < 2 * BLOCK_SIZE ? rows.size() : start + BLOCK_SIZE;
+    new_blocks.push_back(Block{{}, {}, {}, {}, true});
+    std::move(rows.begin() + start, rows.begin() + end, std::back_inserter(new_blocks.back().rows));
+    start = end;
+  }
+  blocks.erase(blocks.begin() + first_block, blocks.begin() + last_block);
+  blocks.insert(blocks.begin() + first_block, std::make_move_iterator(new_blocks.begin()), std::make_move_iterator(new_blocks.end()));
+  update_block_starts();
+}
+
+bool BracketIndex::set_row(size_t row, std::vector<Bracket> &&brackets, bool starts_in_skipped_scope) {
+  if (row >= row_count) return false;
+  const size_t index = find_block(row);
+  Row &current = blocks[index].rows[row - block_starts[index]];
+  const bool changed = current.starts_in_skipped_scope != starts_in_skipped_scope || current.brackets.size() != brackets.size() || !std::equal(brackets.begin(), brackets.end(), current.brackets.begin(), [](const Bracket &a, const Bracket &b) {
+    return a.column == b.column && a.character == b.character;
+  });
+  if (changed) {
+    current.brackets = std::move(brackets);
+    current.starts_in_skipped_scope = starts_in_skipped_scope;
+    blocks[index].stale = true;
+  }
+  return changed;
+}
+
+bool BracketIndex::find_partner(const Point &position, Point &partner) {
+  if (position.row >= row_count) return false;
+  const size_t row = position.row;
+  size_t block_index = find_block(row);
+  size_t row_index = row - block_starts[block_index];
+  const std::vector<Bracket> &brackets = blocks[block_index].rows[row_index].brackets;
+  size_t bracket_index = 0;
+  while (bracket_index < brackets.size() && brackets[bracket_index].column != position.column) {
+    bracket_index++;
+  }
+  if (bracket_index == brackets.size()) return false;
+  bool opening;
+  const int kind = get_kind(brackets[bracket_index].character, opening);
+  if (kind < 0) return false;
+  // how many brackets of this kind are still open between the bracket and the current one
+  int32_t depth = 1;
+  auto visit = [&](const Bracket &bracket) {
+    bool bracket_opening;
+    if (get_kind(bracket.character, bracket_opening) != kind) return false;
+    depth += bracket_opening == opening ? 1 : -1;
+    return depth == 0;
+  };
+  if (opening) {
+    size_t i = bracket_index + 1;
+    for (;;) {
+      const std::vector<Row> &rows = blocks[block_index].rows;
+      for (; row_index < rows.size(); row_index++, i = 0) {
+        const std::vector<Bracket> &row_brackets = rows[row_index].brackets;
+        for (; i < row_brackets.size(); i++) {
+          if (visit(row_brackets[i])) {
+            partner = Point(block_starts[block_index] + row_index, row_brackets[i].column);
+            return true;
+          }
+        }
+      }
+      // whole blocks that never close as many brackets as are open are skipped
+      for (block_index++; block_index < blocks.size(); block_index++) {
+        const Block &block = get_block(block_index);
+        if (depth + block.min_prefix[kind] <= 0) break;
+        depth += block.sum[kind];
+      }
+      if (block_index == blocks.size()) return false;
+      row_index = 0;
+      i = 0;
+    }
+  } else {
+    size_t i = bracket_index;
+    for (;;) {
+      const std::vector<Row> &rows = blocks[block_index].rows;
+      for (;;) {
+        const std::vector<Bracket> &row_brackets = rows[row_index].brackets;
+        while (i-- > 0) {
+          if (visit(row_brackets[i])) {
+            partner = Point(block_starts[block_index] + row_index, row_brackets[i].column);
+            return true;
+          }
+        }
+        if (row_index == 0) break;
+        i = rows[--row_index].brackets.size();
+      }
+      for (;;) {
+        if (block_index == 0) return false;
+        const Block &block = get_block(--block_index);
+        if (block.max_suffix[kind] >= depth) break;
+        depth -= block.sum[kind];
+      }
+      row_index = blocks[block_index].rows.size() - 1;
+      i = blocks[block_index].rows[row_index].brackets.size();
+    }
+  }
+}
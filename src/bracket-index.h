@@ -0,0 +1,50 @@
+#ifndef BRACKET_INDEX_H_
+#define BRACKET_INDEX_H_
+
+#include <point.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Bracket {
+  uint32_t column;
+  char16_t character;
+};
+
+// the brackets of every row, with the ones in strings and comments already left out. the rows
+// are kept in blocks that know how deep each kind of bracket nests within them, so finding a
+// partner skips over blocks that cannot contain it and an edit only touches the blocks it hits.
+// like in Atom, every kind of bracket is matched on its own
+class BracketIndex {
+  struct Row {
+    std::vector<Bracket> brackets;
+    bool starts_in_skipped_scope;
+  };
+  struct Block {
+    std::vector<Row> rows;
+    // per kind of bracket: opening minus closing brackets, the lowest running value from the
+    // start and the highest one from the end
+    int32_t sum[3];
+    int32_t min_prefix[3];
+    int32_t max_suffix[3];
+    bool stale;
+  };
+  std::vector<Block> blocks;
+  // the first row of every block
+  std::vector<size_t> block_starts;
+  size_t row_count;
+  void update_block_starts();
+  size_t find_block(size_t row) const;
+  const Block &get_block(size_t index);
+public:
+  BracketIndex();
+  size_t get_row_count() const;
+  // replaces old_count rows starting at row with new_count empty rows, which are set afterwards
+  void splice(size_t row, size_t old_count, size_t new_count);
+  // returns whether the row changed
+  bool set_row(size_t row, std::vector<Bracket> &&brackets, bool starts_in_skipped_scope);
+  // the position of the bracket that matches the one at position, if there is one
+  bool find_partner(const Point &position, Point &partner);
+};
+
+#endif  // BRACKET_INDEX_H_
@@ -0,0 +1,53 @@
+#include "buffer-change.h"
+#include <algorithm>
+
+#define MAX_DIRTY_INTERVALS 64
+
+Point shift_point(const Point &position, const BufferChange &change) {
+  const Point &old_end = change.old_range.end;
+  const Point &new_end = change.new_range.end;
+  if (position.row == old_end.row) {
+    return Point(new_end.row, new_end.column + position.column - old_end.column);
+  }
+  return Point(position.row + new_end.row - old_end.row, position.column);
+}
+
+void DirtyRows::add(const BufferChange &change) {
+  const double old_start = change.old_range.start.row;
+  const double old_end = change.old_range.end.row;
+  const double delta = change.new_range.end.row - old_end;
+  // the rows of the new text, extended by the intervals that overlap the old text
+  std::pair<double, double> merged(change.new_range.start.row, change.new_range.end.row);
+  std::vector<std::pair<double, double>> result;
+  result.reserve(intervals.size() + 1);
+  size_t i = 0;
+  for (; i < intervals.size() && intervals[i].second < old_start; i++) {
+    result.push_back(intervals[i]);
+  }
+  for (; i < intervals.size() && intervals[i].first <= old_end; i++) {
+    merged.first = std::min(merged.first, intervals[i].first);
+    if (intervals[i].second > old_end) {
+      merged.second = std::max(merged.second, intervals[i].second + delta);
+    }
+  }
+  result.push_back(merged);
+  for (; i < intervals.size(); i++) {
+    result.push_back({intervals[i].first + delta, intervals[i].second + delta});
+  }
+  if (result.size() > MAX_DIRTY_INTERVALS) {
+    result = {{result.front().first, result.back().second}};
+  }
+  intervals = std::move(result);
+}
+
+bool DirtyRows::empty() const {
+  return intervals.empty();
+}
+
+void DirtyRows::clear() {
+  intervals.clear();
+}
+
+const std::vector<std::pair<double, double>> &DirtyRows::get() const {
+  return intervals;
+}
@@ -0,0 +1,29 @@
+#ifndef BUFFER_CHANGE_H_
+#define BUFFER_CHANGE_H_
+
+#include <range.h>
+#include <utility>
+#include <vector>
+
+// one edit of the buffer: the text that was in old_range is now in new_range
+struct BufferChange {
+  Range old_range;
+  Range new_range;
+};
+
+// moves a position at or after the end of the old range along with the text that follows it
+Point shift_point(const Point &, const BufferChange &);
+
+// the rows touched by edits since they were last processed, as sorted and disjoint
+// intervals of current rows. past a limit the intervals are merged into one, so
+// recording a change stays cheap no matter how many cursors made it
+class DirtyRows {
+  std::vector<std::pair<double, double>> intervals;
+public:
+  void add(const BufferChange &);
+  bool empty() const;
+  void clear();
+  const std::vector<std::pair<double, double>> &get() const;
+};
+
+#endif  // BUFFER_CHANGE_H_
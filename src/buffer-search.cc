@@ -0,0 +1,117 @@
+#include "buffer-search.h"
+#define PCRE2_CODE_UNIT_WIDTH 16
+#include <pcre2.h>
+
+#define SEARCH_BATCH_SIZE 1000
+
+BufferSearch::BufferSearch(const std::u16string &pattern, bool regex, bool case_sensitive) : code(nullptr), regex(regex) {
+  if (pattern.empty()) return;
+  uint32_t options = PCRE2_UTF;
+#ifdef PCRE2_MATCH_INVALID_UTF
+  options |= PCRE2_MATCH_INVALID_UTF;
+#endif
+  if (regex) {
+    options |= PCRE2_MULTILINE;
+  } else {
+    options |= PCRE2_LITERAL;
+  }
+  if (!case_sensitive) {
+    options |= PCRE2_CASELESS;
+  }
+  int error_code;
+  PCRE2_SIZE error_offset;
+  code = pcre2_compile((PCRE2_SPTR)pattern.data(), pattern.size(), options, &error_code, &error_offset, NULL);
+  if (code) {
+    // the JIT also scans for the first code unit of a match with SIMD instructions where available
+    pcre2_jit_compile(code, PCRE2_JIT_COMPLETE);
+  }
+}
+
+BufferSearch::~BufferSearch() {
+  if (code) {
+    pcre2_code_free(code);
+  }
+}
+
+bool BufferSearch::is_valid() const {
+  return code != nullptr;
+}
+
+void BufferSearch::search(const std::u16string &text, GCancellable *cancellable, const std::function<void(std::vector<Range> &&)> &callback) const {
+  if (!code) return;
+  pcre2_match_data *match_data = pcre2_match_data_create_from_pattern(code, NULL);
+  std::vector<Range> matches;
+  // the row and column are tracked while scanning since matches are found in order
+  double row = 0;
+  size_t row_start = 0;
+  size_t scanned = 0;
+  auto position_for_index = [&](size_t index) {
+    for (; scanned < index; scanned++) {
+      if (text[scanned] == u'\n') {
+        row++;
+        row_start = scanned + 1;
+      }
+    }
+    return Point(row, index - row_start);
+  };
+  PCRE2_SIZE offset = 0;
+  while (offset <= text.size()) {
+    const int result = pcre2_match(code, (PCRE2_SPTR)text.data(), text.size(), offset, 0, match_data, NULL);
+    if (result < 0) break;
+    const PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(match_data);
+    const size_t start = ovector[0];
+    const size_t end = ovector[1];
+    if (end > start) {
+      const Point start_position = position_for_index(start);
+      const Point end_position = position_for_index(end);
+      matches.push_back(Range(start_position, end_position));
+      offset = end;
+    } else {
+      // skip empty matches without splitting a surrogate pair
+      offset = end + 1;
+      if (offset < text.size() && text[offset] >= 0xDC00 && text[offset] <= 0xDFFF) {
+        offset++;
+      }
+    }
+    if (matches.size() >= SEARCH_BATCH_SIZE) {
+      if (g_cancellable_is_cancelled(cancellable)) break;
+      callback(std::move(matches));
+      matches.clear();
+    }
+  }
+  pcre2_match_data_free(match_data);
+  if (!matches.empty() && !g_cancellable_is_cancelled(cancellable)) {
+    callback(std::move(matches));
+  }
+}
+
+bool BufferSearch::substitute(const std::u16string &text, size_t start, size_t end, const std::u16string &replacement, std::u16string &output, bool at_start, bool at_end) const {
+  if (!code || start > end || end > text.size()) return false;
+  if (!regex) {
+    output = replacement;
+    return true;
+  }
+  pcre2_match_data *match_data = pcre2_match_data_create_from_pattern(code, NULL);
+  // the ends of a window are not the start and end of the subject
+  const uint32_t match_options = PCRE2_ANCHORED | (at_start ? 0 : PCRE2_NOTBOL) | (at_end ? 0 : PCRE2_NOTEOL);
+  int result = pcre2_match(code, (PCRE2_SPTR)text.data(), text.size(), start, match_options, match_data, NULL);
+  if (result < 0 || pcre2_get_ovector_pointer(match_data)[1] != end) {
+    pcre2_match_data_free(match_data);
+    return false;
+  }
+  // only the replacement is written, not the whole subject
+  const uint32_t options = PCRE2_SUBSTITUTE_MATCHED | PCRE2_SUBSTITUTE_REPLACEMENT_ONLY | PCRE2_SUBSTITUTE_OVERFLOW_LENGTH;
+  PCRE2_SIZE length = 0;
+  PCRE2_UCHAR dummy;
+  result = pcre2_substitute(code, (PCRE2_SPTR)text.data(), text.size(), start, options, match_data, NULL, (PCRE2_SPTR)replacement.data(), replacement.size(), &dummy, &length);
+  if (result == PCRE2_ERROR_NOMEMORY) {
+    output.assign(length, u'\0');
+    result = pcre2_substitute(code, (PCRE2_SPTR)text.data(), text.size(), start, options, match_data, NULL, (PCRE2_SPTR)replacement.data(), replacement.size(), (PCRE2_UCHAR *)&output[0], &length);
+  }
+  pcre2_match_data_free(match_data);
+  if (result < 0) {
+    return false;
+  }
+  output.resize(length);
+  return true;
+}
@@ -0,0 +1,31 @@
+#ifndef BUFFER_SEARCH_H_
+#define BUFFER_SEARCH_H_
+
+#include <range.h>
+#include <gio/gio.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct pcre2_real_code_16;
+
+class BufferSearch {
+  pcre2_real_code_16 *code;
+  bool regex;
+public:
+  BufferSearch(const std::u16string &pattern, bool regex, bool case_sensitive);
+  BufferSearch(const BufferSearch &) = delete;
+  ~BufferSearch();
+  BufferSearch &operator =(const BufferSearch &) = delete;
+  bool is_valid() const;
+  // report all matches in text in batches, can be called from any thread
+  void search(const std::u16string &text, GCancellable *cancellable, const std::function<void(std::vector<Range> &&)> &callback) const;
+  // expand references to capture groups like $1 in the replacement text for the match at [start, end)
+  // of text. the pattern is matched again at start, so lookarounds and anchors see the context around
+  // the match. text can be a window of the whole text, at_start and at_end tell whether it begins and
+  // ends where the whole text does. returns false if the pattern no longer matches exactly there or if
+  // the replacement text is invalid
+  bool substitute(const std::u16string &text, size_t start, size_t end, const std::u16string &replacement, std::u16string &output, bool at_start = true, bool at_end = true) const;
+};
+
+#endif  // BUFFER_SEARCH_H_
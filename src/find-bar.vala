@@ -0,0 +1,142 @@
+namespace Atom {
+
+class FindBar : Gtk.Revealer {
+  private Atom.TextEditorWidget text_editor_widget;
+  private Gtk.SearchEntry find_entry;
+  private Gtk.Entry replace_entry;
+  private Gtk.ToggleButton regex_button;
+  private Gtk.ToggleButton case_sensitive_button;
+
+  public FindBar(Atom.TextEditorWidget text_editor_widget) {
+    Object(transition_type: Gtk.RevealerTransitionType.SLIDE_UP);
+    this.text_editor_widget = text_editor_widget;
+
+    var grid = new Gtk.Grid();
+    grid.row_spacing = 4;
+    grid.column_spacing = 4;
+    grid.margin = 4;
+
+    find_entry = new Gtk.SearchEntry();
+    find_entry.hexpand = true;
+    find_entry.placeholder_text = "Find in current buffer";
+    find_entry.search_changed.connect(find);
+    find_entry.activate.connect(() => {
+      text_editor_widget.find_next();
+    });
+    find_entry.next_match.connect(() => {
+      text_editor_widget.find_next();
+    });
+    find_entry.previous_match.connect(() => {
+      text_editor_widget.find_previous();
+    });
+    find_entry.stop_search.connect(hide_bar);
+    grid.attach(find_entry, 0, 0);
+
+    var match_count_label = new Gtk.Label(null);
+    match_count_label.width_chars = 12;
+    text_editor_widget.bind_property("match-count", match_count_label, "label", BindingFlags.SYNC_CREATE, (binding, from_value, ref to_value) => {
+      to_value = pluralize((int)from_value, "result");
+      return true;
+    });
+    grid.attach(match_count_label, 1, 0);
+
+    regex_button = new Gtk.ToggleButton.with_label(".*");
+    regex_button.tooltip_text = "Use Regex";
+    regex_button.toggled.connect(find);
+    case_sensitive_button = new Gtk.ToggleButton.with_label("Aa");
+    case_sensitive_button.tooltip_text = "Match Case";
+    case_sensitive_button.toggled.connect(find);
+    grid.attach(linked(regex_button, case_sensitive_button), 2, 0);
+
+    var find_previous_button = new Gtk.Button.from_icon_name("go-up-symbolic", Gtk.IconSize.BUTTON);
+    find_previous_button.tooltip_text = "Find Previous";
+    find_previous_button.clicked.connect(() => {
+      text_editor_widget.find_previous();
+    });
+    var find_next_button = new Gtk.Button.from_icon_name("go-down-symbolic", Gtk.IconSize.BUTTON);
+    find_next_button.tooltip_text = "Find Next";
+    find_next_button.clicked.connect(() => {
+      text_editor_widget.find_next();
+    });
+    grid.attach(linked(find_previous_button, find_next_button), 3, 0);
+
+    replace_entry = new Gtk.Entry();
+    replace_entry.hexpand = true;
+    replace_entry.placeholder_text = "Replace in current buffer";
+    replace_entry.activate.connect(() => {
+      set_replace_valid(text_editor_widget.replace_next(replace_entry.text));
+    });
+    replace_entry.changed.connect(() => {
+      set_replace_valid(true);
+    });
+    grid.attach(replace_entry, 0, 1, 2);
+
+    var replace_button = new Gtk.Button.with_label("Replace");
+    replace_button.clicked.connect(() => {
+      set_replace_valid(text_editor_widget.replace_next(replace_entry.text));
+    });
+    var replace_all_button = new Gtk.Button.with_label("Replace All");
+    replace_all_button.clicked.connect(() => {
+      set_replace_valid(text_editor_widget.replace_all(replace_entry.text));
+    });
+    grid.attach(linked(replace_button, replace_all_button), 2, 1, 2);
+
+    add(grid);
+  }
+
+  public void show_bar() {
+    reveal_child = true;
+    find_entry.grab_focus();
+    find();
+  }
+
+  public override bool key_press_event(Gdk.EventKey event) {
+    if (event.keyval == Gdk.Key.Escape) {
+      hide_bar();
+      return Gdk.EVENT_STOP;
+    }
+    return base.key_press_event(event);
+  }
+
+  private void hide_bar() {
+    reveal_child = false;
+    text_editor_widget.find("", false, false);
+    text_editor_widget.grab_focus();
+  }
+
+  private void find() {
+    bool valid = text_editor_widget.find(find_entry.text, regex_button.active, case_sensitive_button.active);
+    if (valid) {
+      find_entry.get_style_context().remove_class(Gtk.STYLE_CLASS_ERROR);
+    } else {
+      find_entry.get_style_context().add_class(Gtk.STYLE_CLASS_ERROR);
+    }
+  }
+
+  // the replacement is marked when it could not be expanded, e.g. for a group that does not exist
+  private void set_replace_valid(bool valid) {
+    if (valid) {
+      replace_entry.get_style_context().remove_class(Gtk.STYLE_CLASS_ERROR);
+    } else {
+      replace_entry.get_style_context().add_class(Gtk.STYLE_CLASS_ERROR);
+    }
+  }
+
+  private static Gtk.Widget linked(Gtk.Widget first, Gtk.Widget second) {
+    var box = new Gtk.Box(Gtk.Orientation.HORIZONTAL, 0);
+    box.get_style_context().add_class(Gtk.STYLE_CLASS_LINKED);
+    box.pack_start(first);
+    box.pack_start(second);
+    return box;
+  }
+
+  private static string pluralize(int count, string singular) {
+    if (count == 1) {
+      return "%d %s".printf(count, singular);
+    } else {
+      return "%d %ss".printf(count, singular);
+    }
+  }
+}
+
+}
@@ -0,0 +1,156 @@
+namespace Atom {
+
+class FindInFilesPanel : Gtk.Box {
+  private enum Column {
+    LOCATION,
+    LINE,
+    FILE,
+    ROW,
+    COLUMN,
+  }
+
+  public signal void result_activated(File file, int row, int column);
+
+  private Gtk.SearchEntry find_entry;
+  private Gtk.ToggleButton regex_button;
+  private Gtk.ToggleButton case_sensitive_button;
+  private Gtk.FileChooserButton directory_button;
+  private Gtk.Label status_label;
+  private Gtk.ListStore results;
+  private Atom.ProjectSearch? search;
+  private int result_count;
+
+  public FindInFilesPanel() {
+    Object(orientation: Gtk.Orientation.VERTICAL, spacing: 4);
+
+    var header = new Gtk.Box(Gtk.Orientation.HORIZONTAL, 4);
+    header.margin = 4;
+
+    find_entry = new Gtk.SearchEntry();
+    find_entry.hexpand = true;
+    find_entry.placeholder_text = "Find in project";
+    find_entry.activate.connect(start_search);
+    find_entry.stop_search.connect(hide_panel);
+    header.pack_start(find_entry);
+
+    regex_button = new Gtk.ToggleButton.with_label(".*");
+    regex_button.tooltip_text = "Use Regex";
+    case_sensitive_button = new Gtk.ToggleButton.with_label("Aa");
+    case_sensitive_button.tooltip_text = "Match Case";
+    var toggles = new Gtk.Box(Gtk.Orientation.HORIZONTAL, 0);
+    toggles.get_style_context().add_class(Gtk.STYLE_CLASS_LINKED);
+    toggles.pack_start(regex_button);
+    toggles.pack_start(case_sensitive_button);
+    header.pack_start(toggles, false);
+
+    directory_button = new Gtk.FileChooserButton("Search Folder", Gtk.FileChooserAction.SELECT_FOLDER);
+    directory_button.set_current_folder(Environment.get_current_dir());
+    header.pack_start(directory_button, false);
+
+    status_label = new Gtk.Label(null);
+    status_label.width_chars = 16;
+    header.pack_start(status_label, false);
+    pack_start(header, false);
+
+    results = new Gtk.ListStore(5, typeof(string), typeof(string), typeof(File), typeof(int), typeof(int));
+    var tree_view = new Gtk.TreeView.with_model(results);
+    tree_view.headers_visible = false;
+    // all rows have the same height which lets the tree view skip measuring each of them
+    tree_view.fixed_height_mode = true;
+    var location_column = new Gtk.TreeViewColumn.with_attributes(null, new Gtk.CellRendererText(), "text", Column.LOCATION);
+    location_column.sizing = Gtk.TreeViewColumnSizing.FIXED;
+    location_column.fixed_width = 250;
+    location_column.resizable = true;
+    tree_view.append_column(location_column);
+    var line_column = new Gtk.TreeViewColumn.with_attributes(null, new Gtk.CellRendererText(), "text", Column.LINE);
+    line_column.sizing = Gtk.TreeViewColumnSizing.FIXED;
+    tree_view.append_column(line_column);
+    tree_view.row_activated.connect((path, column) => {
+      Gtk.TreeIter iter;
+      results.get_iter(out iter, path);
+      File file;
+      int row, result_column;
+      results.get(iter, Column.FILE, out file, Column.ROW, out row, Column.COLUMN, out result_column);
+      result_activated(file, row, result_column);
+    });
+    var scrolled_window = new Gtk.ScrolledWindow(null, null);
+    scrolled_window.add(tree_view);
+    pack_start(scrolled_window, true);
+  }
+
+  public void show_panel() {
+    show();
+    find_entry.grab_focus();
+  }
+
+  public override bool key_press_event(Gdk.EventKey event) {
+    if (event.keyval == Gdk.Key.Escape) {
+      hide_panel();
+      return Gdk.EVENT_STOP;
+    }
+    return base.key_press_event(event);
+  }
+
+  private void hide_panel() {
+    stop_search();
+    hide();
+  }
+
+  private void start_search() {
+    stop_search();
+    results.clear();
+    result_count = 0;
+    var directory = directory_button.get_file();
+    if (find_entry.text == "" || directory == null) {
+      status_label.label = "";
+      return;
+    }
+    try {
+      search = new Atom.ProjectSearch(find_entry.text, regex_button.active, case_sensitive_button.active);
+    } catch (RegexError e) {
+      find_entry.get_style_context().add_class(Gtk.STYLE_CLASS_ERROR);
+      status_label.label = "";
+      return;
+    }
+    find_entry.get_style_context().remove_class(Gtk.STYLE_CLASS_ERROR);
+    status_label.label = "Searching…";
+    search.results_found.connect((found) => {
+      // results stream in per file as the worker threads find them
+      found.foreach((result) => {
+        string relative_path = directory.get_relative_path(result.file) ?? result.file.get_path();
+        Gtk.TreeIter iter;
+        results.insert_with_values(out iter, -1,
+          Column.LOCATION, "%s:%d".printf(relative_path, result.row + 1),
+          Column.LINE, result.line,
+          Column.FILE, result.file,
+          Column.ROW, result.row,
+          Column.COLUMN, result.column
+        );
+      });
+      result_count += found.length;
+      status_label.label = pluralize(result_count, "result");
+    });
+    search.finished.connect((truncated) => {
+      status_label.label = pluralize(result_count, "result") + (truncated ? "+" : "");
+      search = null;
+    });
+    search.start(directory);
+  }
+
+  private void stop_search() {
+    if (search != null) {
+      search.cancel();
+      search = null;
+    }
+  }
+
+  private static string pluralize(int count, string singular) {
+    if (count == 1) {
+      return "%d %s".printf(count, singular);
+    } else {
+      return "%d %ss".printf(count, singular);
+    }
+  }
+}
+
+}
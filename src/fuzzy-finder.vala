@@ -0,0 +1,117 @@
+namespace Atom {
+
+class FuzzyFinder : Gtk.Dialog {
+  private const int MAX_RESULTS = 50;
+
+  public signal void file_selected(File file);
+
+  private File root;
+  private Atom.PathIndex index;
+  private Gtk.SearchEntry query_entry;
+  private Gtk.ListStore results;
+  private Gtk.TreeView tree_view;
+
+  public FuzzyFinder(Gtk.Window window, File root) {
+    Object(transient_for: window, modal: true, destroy_with_parent: true, use_header_bar: 1, title: "Open File");
+    this.root = root;
+    index = new Atom.PathIndex(root);
+    index.updated.connect(update);
+    set_default_size(500, 400);
+
+    query_entry = new Gtk.SearchEntry();
+    query_entry.margin = 4;
+    query_entry.placeholder_text = "Find file by name";
+    query_entry.search_changed.connect(update);
+    query_entry.activate.connect(open_selected);
+    query_entry.stop_search.connect(() => {
+      hide();
+    });
+    query_entry.next_match.connect(() => move_selection(1));
+    query_entry.previous_match.connect(() => move_selection(-1));
+    get_content_area().pack_start(query_entry, false);
+
+    results = new Gtk.ListStore(1, typeof(string));
+    tree_view = new Gtk.TreeView.with_model(results);
+    tree_view.headers_visible = false;
+    tree_view.fixed_height_mode = true;
+    var column = new Gtk.TreeViewColumn.with_attributes(null, new Gtk.CellRendererText(), "text", 0);
+    column.sizing = Gtk.TreeViewColumnSizing.FIXED;
+    tree_view.append_column(column);
+    tree_view.row_activated.connect(() => {
+      open_selected();
+    });
+    var scrolled_window = new Gtk.ScrolledWindow(null, null);
+    scrolled_window.vexpand = true;
+    scrolled_window.add(tree_view);
+    get_content_area().pack_start(scrolled_window, true);
+    get_content_area().show_all();
+
+    delete_event.connect(() => hide_on_delete());
+  }
+
+  public void show_finder() {
+    index.refresh();
+    query_entry.text = "";
+    update();
+    present();
+    query_entry.grab_focus();
+  }
+
+  public override bool key_press_event(Gdk.EventKey event) {
+    switch (event.keyval) {
+      case Gdk.Key.Up:
+        move_selection(-1);
+        return Gdk.EVENT_STOP;
+      case Gdk.Key.Down:
+        move_selection(1);
+        return Gdk.EVENT_STOP;
+      default:
+        return base.key_press_event(event);
+    }
+  }
+
+  private void update() {
+    results.clear();
+    if (!index.ready) {
+      title = "Indexing…";
+      return;
+    }
+    title = "Open File";
+    // the index narrows down the previous candidates while the query keeps growing
+    foreach (unowned string path in index.match(query_entry.text, MAX_RESULTS)) {
+      Gtk.TreeIter iter;
+      results.insert_with_values(out iter, -1, 0, path);
+    }
+    Gtk.TreeIter first;
+    if (results.get_iter_first(out first)) {
+      tree_view.get_selection().select_iter(first);
+    }
+  }
+
+  private void move_selection(int delta) {
+    Gtk.TreeModel model;
+    Gtk.TreeIter iter;
+    if (!tree_view.get_selection().get_selected(out model, out iter)) {
+      return;
+    }
+    bool moved = delta > 0 ? results.iter_next(ref iter) : results.iter_previous(ref iter);
+    if (moved) {
+      tree_view.get_selection().select_iter(iter);
+      tree_view.scroll_to_cell(results.get_path(iter), null, false, 0, 0);
+    }
+  }
+
+  private void open_selected() {
+    Gtk.TreeModel model;
+    Gtk.TreeIter iter;
+    if (!tree_view.get_selection().get_selected(out model, out iter)) {
+      return;
+    }
+    string path;
+    results.get(iter, 0, out path);
+    hide();
+    file_selected(root.resolve_relative_path(path));
+  }
+}
+
+}
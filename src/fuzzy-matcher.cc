@@ -0,0 +1,237 @@
+#include "fuzzy-matcher.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// below this number of candidates spawning threads costs more than it saves
+#define PARALLEL_THRESHOLD 16384
+
+namespace {
+
+struct Entry {
+  std::string path;
+  std::string lowercase;
+  size_t basename;
+};
+
+struct Match {
+  int score;
+  size_t index;
+};
+
+struct Index {
+  std::vector<Entry> entries;
+  // the character masks are kept apart from the entries so the prefilter scans contiguous memory
+  std::vector<uint64_t> masks;
+  std::unordered_map<std::string, size_t> indices;
+  // the candidates of the last query, a longer query can only match a subset of them
+  std::string last_query;
+  std::vector<size_t> last_candidates;
+  bool has_last_candidates = false;
+};
+
+}
+
+struct _AtomFuzzyMatcher {
+  GObject parent_instance;
+  Index *index;
+};
+
+G_DEFINE_TYPE(AtomFuzzyMatcher, atom_fuzzy_matcher, G_TYPE_OBJECT)
+
+static void atom_fuzzy_matcher_finalize(GObject *object) {
+  AtomFuzzyMatcher *self = ATOM_FUZZY_MATCHER(object);
+  delete self->index;
+  G_OBJECT_CLASS(atom_fuzzy_matcher_parent_class)->finalize(object);
+}
+
+static void atom_fuzzy_matcher_class_init(AtomFuzzyMatcherClass *klass) {
+  G_OBJECT_CLASS(klass)->finalize = atom_fuzzy_matcher_finalize;
+}
+
+static void atom_fuzzy_matcher_init(AtomFuzzyMatcher *self) {
+  self->index = new Index();
+}
+
+AtomFuzzyMatcher *atom_fuzzy_matcher_new() {
+  return ATOM_FUZZY_MATCHER(g_object_new(ATOM_TYPE_FUZZY_MATCHER, NULL));
+}
+
+static std::string to_lowercase(const char *text) {
+  std::string lowercase(text);
+  for (char &c : lowercase) {
+    c = g_ascii_tolower(c);
+  }
+  return lowercase;
+}
+
+// one bit per letter and digit, other bytes share the remaining bits
+static uint64_t get_character_mask(const std::string &lowercase) {
+  uint64_t mask = 0;
+  for (unsigned char c : lowercase) {
+    if (c >= 'a' && c <= 'z') {
+      mask |= uint64_t(1) << (c - 'a');
+    } else if (c >= '0' && c <= '9') {
+      mask |= uint64_t(1) << (26 + c - '0');
+    } else {
+      mask |= uint64_t(1) << (36 + c % 28);
+    }
+  }
+  return mask;
+}
+
+static bool is_word_start(const std::string &path, size_t i) {
+  if (i == 0) return true;
+  const char previous = path[i - 1];
+  return previous == '/' || previous == '_' || previous == '-' || previous == '.' || previous == ' ' || (g_ascii_islower(previous) && g_ascii_isupper(path[i]));
+}
+
+static int score_from(const Entry &entry, const std::string &query, size_t start) {
+  int score = 0;
+  size_t q = 0;
+  bool consecutive = false;
+  for (size_t i = start; i < entry.lowercase.size() && q < query.size(); i++) {
+    if (entry.lowercase[i] == query[q]) {
+      score += 1;
+      if (consecutive) score += 4;
+      if (is_word_start(entry.path, i)) score += 8;
+      consecutive = true;
+      q++;
+    } else {
+      consecutive = false;
+    }
+  }
+  if (q < query.size()) return -1;
+  return score;
+}
+
+// returns -1 if the query is not a subsequence of the path
+static int score_entry(const Entry &entry, const std::string &query) {
+  int score = score_from(entry, query, entry.basename);
+  if (score >= 0) {
+    // prefer matches that lie entirely in the file name
+    score += 2 * static_cast<int>(query.size());
+  } else {
+    score = score_from(entry, query, 0);
+    if (score < 0) return -1;
+  }
+  return score * 128 - static_cast<int>(std::min<size_t>(entry.path.size(), 127));
+}
+
+static void match_range(const Index *index, const size_t *candidates, size_t begin, size_t end, const std::string &query, uint64_t query_mask, std::vector<Match> &matches) {
+  for (size_t i = begin; i < end; i++) {
+    const size_t entry_index = candidates ? candidates[i] : i;
+    if ((index->masks[entry_index] & query_mask) != query_mask) continue;
+    const int score = score_entry(index->entries[entry_index], query);
+    if (score >= 0) {
+      matches.push_back({score, entry_index});
+    }
+  }
+}
+
+void atom_fuzzy_matcher_set_paths(AtomFuzzyMatcher *self, const gchar **paths, gint length) {
+  Index *index = self->index;
+  index->entries.clear();
+  index->masks.clear();
+  index->indices.clear();
+  index->has_last_candidates = false;
+  index->entries.reserve(length);
+  index->masks.reserve(length);
+  for (gint i = 0; i < length; i++) {
+    atom_fuzzy_matcher_add_path(self, paths[i]);
+  }
+}
+
+void atom_fuzzy_matcher_add_path(AtomFuzzyMatcher *self, const gchar *path) {
+  Index *index = self->index;
+  if (index->indices.count(path)) return;
+  const char *basename = strrchr(path, '/');
+  Entry entry;
+  entry.path = path;
+  entry.lowercase = to_lowercase(path);
+  entry.basename = basename ? basename - path + 1 : 0;
+  index->indices[entry.path] = index->entries.size();
+  index->masks.push_back(get_character_mask(entry.lowercase));
+  index->entries.push_back(std::move(entry));
+  index->has_last_candidates = false;
+}
+
+// removes the path and, if it is a directory, everything below it
+void atom_fuzzy_matcher_remove_path(AtomFuzzyMatcher *self, const gchar *path) {
+  Index *index = self->index;
+  const std::string prefix = std::string(path) + '/';
+  for (size_t i = 0; i < index->entries.size();) {
+    const std::string &entry_path = index->entries[i].path;
+    if (entry_path == path || entry_path.compare(0, prefix.size(), prefix) == 0) {
+      // swap with the last entry to avoid shifting the whole vector
+      index->indices.erase(entry_path);
+      if (i + 1 < index->entries.size()) {
+        index->entries[i] = std::move(index->entries.back());
+        index->masks[i] = index->masks.back();
+        index->indices[index->entries[i].path] = i;
+      }
+      index->entries.pop_back();
+      index->masks.pop_back();
+      index->has_last_candidates = false;
+    } else {
+      i++;
+    }
+  }
+}
+
+gint atom_fuzzy_matcher_get_path_count(AtomFuzzyMatcher *self) {
+  return self->index->entries.size();
+}
+
+gchar **atom_fuzzy_matcher_match(AtomFuzzyMatcher *self, const gchar *query, gint max_results) {
+  Index *index = self->index;
+  const std::string lowercase_query = to_lowercase(query);
+  std::vector<Match> matches;
+  if (lowercase_query.empty()) {
+    for (size_t i = 0; i < index->entries.size(); i++) {
+      matches.push_back({0, i});
+    }
+    index->has_last_candidates = false;
+  } else {
+    const bool refine = index->has_last_candidates && lowercase_query.compare(0, index->last_query.size(), index->last_query) == 0;
+    const size_t *candidates = refine ? index->last_candidates.data() : nullptr;
+    const size_t count = refine ? index->last_candidates.size() : index->entries.size();
+    const uint64_t query_mask = get_character_mask(lowercase_query);
+    // split the candidates into one contiguous chunk per core
+    const size_t thread_count = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), count / PARALLEL_THRESHOLD));
+    const size_t chunk_size = (count + thread_count - 1) / thread_count;
+    std::vector<std::vector<Match>> chunk_matches(thread_count);
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < thread_count; t++) {
+      threads.emplace_back(match_range, index, candidates, t * chunk_size, std::min(count, (t + 1) * chunk_size), std::cref(lowercase_query), query_mask, std::ref(chunk_matches[t]));
+    }
+    match_range(index, candidates, 0, std::min(count, chunk_size), lowercase_query, query_mask, chunk_matches[0]);
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    for (std::vector<Match> &chunk : chunk_matches) {
+      matches.insert(matches.end(), chunk.begin(), chunk.end());
+    }
+    index->last_query = lowercase_query;
+    index->last_candidates.clear();
+    index->last_candidates.reserve(matches.size());
+    for (const Match &match : matches) {
+      index->last_candidates.push_back(match.index);
+    }
+    index->has_last_candidates = true;
+  }
+  const size_t result_count = std::min<size_t>(matches.size(), std::max(max_results, 0));
+  std::partial_sort(matches.begin(), matches.begin() + result_count, matches.end(), [&](const Match &a, const Match &b) {
+    if (a.score != b.score) return a.score > b.score;
+    return index->entries[a.index].path < index->entries[b.index].path;
+  });
+  gchar **results = g_new0(gchar *, result_count + 1);
+  for (size_t i = 0; i < result_count; i++) {
+    results[i] = g_strdup(index->entries[matches[i].index].path.c_str());
+  }
+  return results;
+}
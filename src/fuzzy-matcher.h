@@ -0,0 +1,20 @@
+#ifndef ATOM_FUZZY_MATCHER_H_
+#define ATOM_FUZZY_MATCHER_H_
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define ATOM_TYPE_FUZZY_MATCHER atom_fuzzy_matcher_get_type()
+G_DECLARE_FINAL_TYPE(AtomFuzzyMatcher, atom_fuzzy_matcher, ATOM, FUZZY_MATCHER, GObject)
+
+AtomFuzzyMatcher *atom_fuzzy_matcher_new(void);
+void atom_fuzzy_matcher_set_paths(AtomFuzzyMatcher *, const gchar **, gint);
+void atom_fuzzy_matcher_add_path(AtomFuzzyMatcher *, const gchar *);
+void atom_fuzzy_matcher_remove_path(AtomFuzzyMatcher *, const gchar *);
+gint atom_fuzzy_matcher_get_path_count(AtomFuzzyMatcher *);
+gchar **atom_fuzzy_matcher_match(AtomFuzzyMatcher *, const gchar *, gint);
+
+G_END_DECLS
+
+#endif  // ATOM_FUZZY_MATCHER_H_
@@ -0,0 +1,59 @@
+namespace Atom {
+
+// a simplified subset of the .gitignore syntax, inherited by subdirectories
+class IgnoreRules {
+  private IgnoreRules? parent;
+  private string base_path;
+  private PatternSpec[] patterns = {};
+  private bool[] directory_only = {};
+  private bool[] match_path = {};
+
+  public IgnoreRules(IgnoreRules? parent, string base_path) {
+    this.parent = parent;
+    this.base_path = base_path;
+  }
+
+  public static IgnoreRules? load(IgnoreRules? parent, File directory) {
+    string contents;
+    try {
+      FileUtils.get_contents(Path.build_filename(directory.get_path(), ".gitignore"), out contents);
+    } catch (FileError e) {
+      return parent;
+    }
+    var rules = new IgnoreRules(parent, directory.get_path());
+    foreach (unowned string line in contents.split("\n")) {
+      string pattern = line.strip();
+      // negated patterns are not supported and are ignored
+      if (pattern == "" || pattern.has_prefix("#") || pattern.has_prefix("!")) {
+        continue;
+      }
+      bool is_directory_only = pattern.has_suffix("/");
+      if (is_directory_only) {
+        pattern = pattern.substring(0, pattern.length - 1);
+      }
+      bool is_path = pattern.contains("/");
+      if (pattern.has_prefix("/")) {
+        pattern = pattern.substring(1);
+      }
+      rules.patterns += new PatternSpec(pattern);
+      rules.directory_only += is_directory_only;
+      rules.match_path += is_path;
+    }
+    return rules;
+  }
+
+  public bool is_ignored(string path, string name, bool is_directory) {
+    string relative_path = path.substring(base_path.length + 1);
+    for (int i = 0; i < patterns.length; i++) {
+      if (directory_only[i] && !is_directory) {
+        continue;
+      }
+      if (patterns[i].match_string(match_path[i] ? relative_path : name)) {
+        return true;
+      }
+    }
+    return parent != null && parent.is_ignored(path, name, is_directory);
+  }
+}
+
+}
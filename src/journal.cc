@@ -0,0 +1,79 @@
+#include "journal.h"
+#include <cstring>
+
+#define JOURNAL_MAGIC 0x4e524a41
+#define JOURNAL_VERSION 2
+
+template <class T> static void append_value(std::string &data, T value) {
+  data.append((const char *)&value, sizeof(T));
+}
+
+static void append_point(std::string &data, const Point &point) {
+  append_value<uint32_t>(data, point.row);
+  append_value<uint32_t>(data, point.column);
+}
+
+void append_journal_header(std::string &data, const JournalHeader &header) {
+  append_value<uint32_t>(data, JOURNAL_MAGIC);
+  append_value<uint32_t>(data, JOURNAL_VERSION);
+  append_value<int64_t>(data, header.base_mtime);
+  append_value<int64_t>(data, header.base_size);
+  append_value<uint64_t>(data, header.base_length);
+  append_value<uint32_t>(data, header.file_path.size());
+  data.append(header.file_path);
+}
+
+void append_journal_record(std::string &data, const Range &old_range, const std::u16string &text) {
+  append_point(data, old_range.start);
+  append_point(data, old_range.end);
+  append_value<uint32_t>(data, text.size());
+  data.append((const char *)text.data(), text.size() * sizeof(char16_t));
+}
+
+bool parse_journal(const char *data, size_t length, JournalHeader &header, std::vector<JournalRecord> &records) {
+  const char *end = data + length;
+  auto read = [&](auto &value) {
+    if ((size_t)(end - data) < sizeof(value)) return false;
+    memcpy(&value, data, sizeof(value));
+    data += sizeof(value);
+    return true;
+  };
+  auto read_point = [&](Point &point) {
+    uint32_t row, column;
+    if (!read(row) || !read(column)) return false;
+    point = Point(row, column);
+    return true;
+  };
+  uint32_t magic, version, path_length;
+  if (!read(magic) || magic != JOURNAL_MAGIC || !read(version) || version != JOURNAL_VERSION) return false;
+  if (!read(header.base_mtime) || !read(header.base_size) || !read(header.base_length)) return false;
+  if (!read(path_length) || (size_t)(end - data) < path_length) return false;
+  header.file_path.assign(data, path_length);
+  data += path_length;
+  records.clear();
+  for (;;) {
+    JournalRecord record;
+    uint32_t text_length;
+    if (!read_point(record.old_range.start) || !read_point(record.old_range.end) || !read(text_length)) break;
+    if ((size_t)(end - data) / sizeof(char16_t) < text_length) break;
+    // the text is not aligned after the path
+    record.text.resize(text_length);
+    memcpy(&record.text[0], data, text_length * sizeof(char16_t));
+    data += text_length * sizeof(char16_t);
+    records.push_back(std::move(record));
+  }
+  return true;
+}
+
+bool replay_journal(TextBuffer *buffer, const std::vector<JournalRecord> &records) {
+  auto fits = [&](const Point &point) {
+    return point.row <= buffer->getLastRow() && point.column <= buffer->lineLengthForRow(point.row);
+  };
+  for (const JournalRecord &record : records) {
+    const Range &range = record.old_range;
+    const bool ordered = range.start.row < range.end.row || (range.start.row == range.end.row && range.start.column <= range.end.column);
+    if (!ordered || !fits(range.start) || !fits(range.end)) return false;
+    buffer->setTextInRange(range, record.text);
+  }
+  return true;
+}
@@ -0,0 +1,33 @@
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <range.h>
+#include <text-buffer.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// unsaved edits are appended to a journal so that they can be replayed after a crash. the journal
+// starts from the file as it was on disk and holds one record per edit
+struct JournalHeader {
+  std::string file_path;
+  // the modification time in nanoseconds and the size of the file, and the length of its text
+  int64_t base_mtime;
+  int64_t base_size;
+  uint64_t base_length;
+};
+
+// the text that replaced old_range
+struct JournalRecord {
+  Range old_range;
+  std::u16string text;
+};
+
+void append_journal_header(std::string &data, const JournalHeader &);
+void append_journal_record(std::string &data, const Range &old_range, const std::u16string &text);
+// returns false unless the data starts with a valid header. a record cut short by a crash ends the records
+bool parse_journal(const char *data, size_t length, JournalHeader &, std::vector<JournalRecord> &);
+// applies the records in order, returns false at the first one that does not fit the text
+bool replay_journal(TextBuffer *, const std::vector<JournalRecord> &);
+
+#endif  // JOURNAL_H_
@@ -2,6 +2,7 @@
 #define LAYOUT_CACHE_H_
 
 #include <display-layer.h>
+#include <memory>
 #include <unordered_map>
 
 template <class T> void hash_combine(size_t &seed, T const &v);
@@ -14,6 +15,9 @@ inline size_t hash_value(char16_t v) {
 inline size_t hash_value(int32_t v) {
   return v;
 }
+inline size_t hash_value(size_t v) {
+  return v;
+}
 template <class T> std::size_t hash_value(const T *ptr) {
   return reinterpret_cast<std::size_t>(ptr);
 }
@@ -33,13 +37,73 @@ template <class T> size_t hash_value(const std::vector<T> &v) {
 template <class T> void hash_combine(size_t &seed, T const &v) {
   seed ^= hash_value(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
 }
+// long sequences are hashed from their size and a bounded sample of their elements, equality
+// still compares them whole
+template <class Sequence> size_t hash_sample(const Sequence &v, size_t samples = 1024) {
+  if (v.size() <= samples) return hash_range(v.begin(), v.end());
+  size_t seed = v.size();
+  const size_t step = v.size() / samples;
+  for (size_t i = 0; i < v.size(); i += step) {
+    hash_combine(seed, v[i]);
+  }
+  return seed;
+}
+
+// the segments of long lines by their text and tags, so that the layouts of the versions of a line
+// share the segments an edit did not change
+template <class Component, class Segment> class SegmentCache {
+  struct Key {
+    std::u16string text;
+    std::vector<int32_t> tags;
+    bool cached;
+  };
+  struct Hash {
+    size_t operator ()(const Key &key) const {
+      size_t seed = 0;
+      hash_combine(seed, key.text);
+      hash_combine(seed, key.tags);
+      hash_combine(seed, (int32_t)key.cached);
+      return seed;
+    }
+  };
+  struct Equal {
+    bool operator ()(const Key &lhs, const Key &rhs) const {
+      return lhs.text == rhs.text && lhs.tags == rhs.tags && lhs.cached == rhs.cached;
+    }
+  };
+  std::unordered_map<Key, std::shared_ptr<Segment>, Hash, Equal> cache;
+public:
+  // drops the segments that no layout holds anymore
+  void collect_garbage() {
+    for (auto iterator = cache.begin(); iterator != cache.end();) {
+      if (iterator->second.use_count() == 1) {
+        iterator = cache.erase(iterator);
+      } else {
+        ++iterator;
+      }
+    }
+  }
+  void clear() {
+    cache.clear();
+  }
+  std::shared_ptr<Segment> get_segment(Component *self, std::u16string &&text, std::vector<int32_t> &&tags, bool cached) {
+    Key key{std::move(text), std::move(tags), cached};
+    auto iterator = cache.find(key);
+    if (iterator != cache.end()) {
+      return iterator->second;
+    }
+    std::shared_ptr<Segment> segment = std::make_shared<Segment>(self, key.text, key.tags, key.cached);
+    cache.insert({std::move(key), segment});
+    return segment;
+  }
+};
 
-template <class Component, class Layout> class LayoutCache {
+template <class Component, class Layout, class Segment> class LayoutCache {
   struct Hash {
     size_t operator ()(const DisplayLayer::ScreenLine &screen_line) const {
       size_t seed = 0;
-      hash_combine(seed, screen_line.lineText);
-      hash_combine(seed, screen_line.tags);
+      hash_combine(seed, hash_sample(screen_line.lineText));
+      hash_combine(seed, hash_sample(screen_line.tags));
       return seed;
     }
   };
@@ -49,28 +113,38 @@ template <class Component, class Layout> class LayoutCache {
     }
   };
   std::unordered_map<DisplayLayer::ScreenLine, std::pair<Layout, size_t>, Hash, Equal> cache;
-  std::unordered_map<double, std::pair<Layout, size_t>> line_number_cache;
+  // line numbers are composed from the layouts of the ten digits and the bullet of soft wrapped rows
+  std::vector<Layout> glyphs;
+  SegmentCache<Component, Segment> segments;
   size_t generation = 0;
+  bool created = false;
 public:
+  // entries from the previous generation are kept since they include the layouts prepared for this one
   void collect_garbage() {
     for (auto iterator = cache.begin(); iterator != cache.end();) {
-      if (iterator->second.second != generation) {
+      if (generation - iterator->second.second > 1) {
         iterator = cache.erase(iterator);
       } else {
         ++iterator;
       }
     }
-    for (auto iterator = line_number_cache.begin(); iterator != line_number_cache.end();) {
-      if (iterator->second.second != generation) {
-        iterator = line_number_cache.erase(iterator);
-      } else {
-        ++iterator;
-      }
-    }
+    segments.collect_garbage();
   }
   void increment_generation() {
     generation++;
   }
+  void clear() {
+    cache.clear();
+    glyphs.clear();
+    segments.clear();
+    created = true;
+  }
+  // whether layouts have been created or dropped since the last call
+  bool take_created() {
+    const bool result = created;
+    created = false;
+    return result;
+  }
   Layout get_layout(Component *self, const DisplayLayer::ScreenLine &screen_line) {
     auto iterator = cache.find(screen_line);
     if (iterator != cache.end()) {
@@ -79,26 +153,33 @@ public:
     } else {
       Layout layout(self, screen_line);
       cache.insert({screen_line, {layout, generation}});
+      created = true;
       return layout;
     }
   }
+  std::shared_ptr<Segment> get_segment(Component *self, std::u16string &&text, std::vector<int32_t> &&tags, bool cached) {
+    return segments.get_segment(self, std::move(text), std::move(tags), cached);
+  }
   std::vector<Layout> get_layouts(Component *self, const std::vector<DisplayLayer::ScreenLine> &screen_lines) {
     std::vector<Layout> layouts;
+    get_layouts(self, screen_lines, layouts);
+    return layouts;
+  }
+  // reuses the capacity of layouts
+  void get_layouts(Component *self, const std::vector<DisplayLayer::ScreenLine> &screen_lines, std::vector<Layout> &layouts) {
+    layouts.clear();
     for (size_t i = 0; i < screen_lines.size(); i++) {
       layouts.push_back(get_layout(self, screen_lines[i]));
     }
-    return layouts;
   }
-  Layout get_line_number(Component *self, double row) {
-    auto iterator = line_number_cache.find(row);
-    if (iterator != line_number_cache.end()) {
-      iterator->second.second = generation;
-      return iterator->second.first;
-    } else {
-      Layout layout(self, row);
-      line_number_cache.insert({row, {layout, generation}});
-      return layout;
+  // glyph is a digit or 10 for the bullet
+  const Layout &get_glyph(Component *self, int glyph) {
+    if (glyphs.empty()) {
+      for (int i = 0; i <= 10; i++) {
+        glyphs.push_back(Layout(self, i));
+      }
     }
+    return glyphs[glyph];
   }
 };
 
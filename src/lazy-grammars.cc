@@ -0,0 +1,35 @@
+#include "lazy-grammars.h"
+#include <glib.h>
+#include <algorithm>
+
+extern "C" TreeSitterGrammar *atom_language_c();
+extern "C" TreeSitterGrammar *atom_language_cpp();
+extern "C" TreeSitterGrammar *atom_language_css();
+extern "C" TreeSitterGrammar *atom_language_go();
+extern "C" TreeSitterGrammar *atom_language_html();
+extern "C" TreeSitterGrammar *atom_language_javascript();
+extern "C" TreeSitterGrammar *atom_language_json();
+extern "C" TreeSitterGrammar *atom_language_python();
+extern "C" TreeSitterGrammar *atom_language_rust();
+
+LazyGrammar lazy_grammars[] = {
+  {atom_language_c, {"c", "h"}, NULL, false},
+  {atom_language_cpp, {"cc", "cpp", "cp", "cxx", "c++", "cu", "cuh", "h", "hh", "h++", "hpp", "hxx", "inl", "ino", "ipp", "tcc", "tpp"}, NULL, false},
+  {atom_language_css, {"css"}, NULL, false},
+  {atom_language_go, {"go"}, NULL, false},
+  {atom_language_html, {"html", "htm", "xhtml"}, NULL, false},
+  {atom_language_javascript, {"js", "cjs", "mjs", "jsx", "es6", "jsm"}, "^#!.*\\b(node|nodejs)\\b", false},
+  {atom_language_json, {"json", "babelrc", "geojson", "jshintrc", "topojson", "webmanifest"}, NULL, false},
+  {atom_language_python, {"py", "pyi", "pyw", "gyp", "gypi", "wsgi", "SConstruct", "SConscript", "wscript"}, "^#!.*\\bpython[\\d.]*\\b", false},
+  {atom_language_rust, {"rs"}, NULL, false},
+};
+
+const size_t lazy_grammar_count = G_N_ELEMENTS(lazy_grammars);
+
+bool lazy_grammar_matches(const LazyGrammar &lazy_grammar, const std::string &basename, const std::string &extension, const char *first_line) {
+  const std::vector<std::string> &file_types = lazy_grammar.file_types;
+  if (std::find(file_types.begin(), file_types.end(), extension) != file_types.end() || std::find(file_types.begin(), file_types.end(), basename) != file_types.end()) {
+    return true;
+  }
+  return lazy_grammar.first_line_pattern && first_line && g_regex_match_simple(lazy_grammar.first_line_pattern, first_line, (GRegexCompileFlags)0, (GRegexMatchFlags)0);
+}
@@ -0,0 +1,24 @@
+#ifndef LAZY_GRAMMARS_H_
+#define LAZY_GRAMMARS_H_
+
+#include <grammar-registry.h>
+#include <grammar.h>
+#include <string>
+#include <vector>
+
+// the built-in grammars are only created once a file needs them. the file types have to
+// agree with the ones of the grammars themselves, which the lazy-grammars test checks
+struct LazyGrammar {
+  TreeSitterGrammar *(*create)();
+  std::vector<std::string> file_types;
+  const char *first_line_pattern;
+  bool added;
+};
+
+extern LazyGrammar lazy_grammars[];
+extern const size_t lazy_grammar_count;
+
+// whether a file with this name, lowercase extension and first line needs the grammar
+bool lazy_grammar_matches(const LazyGrammar &, const std::string &basename, const std::string &extension, const char *first_line);
+
+#endif  // LAZY_GRAMMARS_H_
@@ -0,0 +1,173 @@
+#include "line-diff.h"
+#include <algorithm>
+#include <cstdint>
+
+// above this many cells the longest common subsequence is not computed and the remaining lines form one hunk
+#define MAX_DIFF_CELLS (1 << 20)
+// past this many edits between two updates the whole text is diffed again
+#define MAX_PENDING_CHANGES 256
+
+std::vector<LineHunk> diff_lines(const std::u16string *old_lines, size_t old_count, const std::u16string *new_lines, size_t new_count) {
+  std::vector<LineHunk> hunks;
+  size_t old_start = 0;
+  size_t new_start = 0;
+  size_t old_end = old_count;
+  size_t new_end = new_count;
+  // edits are local, so trimming the common prefix and suffix leaves only the edited region to diff
+  while (old_start < old_end && new_start < new_end && old_lines[old_start] == new_lines[new_start]) {
+    old_start++;
+    new_start++;
+  }
+  while (old_end > old_start && new_end > new_start && old_lines[old_end - 1] == new_lines[new_end - 1]) {
+    old_end--;
+    new_end--;
+  }
+  const size_t n = old_end - old_start;
+  const size_t m = new_end - new_start;
+  if (n == 0 && m == 0) return hunks;
+  if (n == 0 || m == 0 || n * m > MAX_DIFF_CELLS) {
+    hunks.push_back({old_start, n, new_start, m, false});
+    return hunks;
+  }
+  // longest common subsequence of the remaining lines
+  std::vector<uint32_t> lcs((n + 1) * (m + 1), 0);
+  auto at = [&](size_t i, size_t j) -> uint32_t & {
+    return lcs[i * (m + 1) + j];
+  };
+  for (size_t i = n; i-- > 0;) {
+    for (size_t j = m; j-- > 0;) {
+      if (old_lines[old_start + i] == new_lines[new_start + j]) {
+        at(i, j) = at(i + 1, j + 1) + 1;
+      } else {
+        at(i, j) = std::max(at(i + 1, j), at(i, j + 1));
+      }
+    }
+  }
+  size_t i = 0;
+  size_t j = 0;
+  bool in_hunk = false;
+  while (i < n || j < m) {
+    if (i < n && j < m && old_lines[old_start + i] == new_lines[new_start + j]) {
+      in_hunk = false;
+      i++;
+      j++;
+      continue;
+    }
+    if (!in_hunk) {
+      in_hunk = true;
+      hunks.push_back({old_start + i, 0, new_start + j, 0, false});
+    }
+    if (j < m && (i == n || at(i, j + 1) >= at(i + 1, j))) {
+      hunks.back().new_count++;
+      j++;
+    } else {
+      hunks.back().old_count++;
+      i++;
+    }
+  }
+  return hunks;
+}
+
+LineDiff::LineDiff() : change_count(0), valid(false) {}
+
+void LineDiff::set_hunks(std::vector<LineHunk> &&hunks) {
+  this->hunks = std::move(hunks);
+  change_count = 0;
+  valid = true;
+}
+
+bool LineDiff::is_valid() const {
+  return valid;
+}
+
+void LineDiff::invalidate() {
+  valid = false;
+  hunks.clear();
+}
+
+// whether the hunk lies on the rows from first to last or, if it only removes lines, right next to them
+static bool touches_rows(const LineHunk &hunk, size_t first, size_t last) {
+  if (hunk.new_count == 0) {
+    return hunk.new_start >= first && hunk.new_start <= last + 1;
+  }
+  return hunk.new_start <= last && hunk.new_start + hunk.new_count > first;
+}
+
+void LineDiff::add_change(const BufferChange &change) {
+  if (!valid) return;
+  if (++change_count > MAX_PENDING_CHANGES) {
+    invalidate();
+    return;
+  }
+  const size_t first_row = change.old_range.start.row;
+  const size_t last_row = change.old_range.end.row;
+  const int64_t delta = (int64_t)change.new_range.end.row - (int64_t)last_row;
+  size_t first = 0;
+  while (first < hunks.size() && !touches_rows(hunks[first], first_row, last_row) && hunks[first].new_start <= last_row) {
+    first++;
+  }
+  size_t last = first;
+  while (last < hunks.size() && touches_rows(hunks[last], first_row, last_row)) {
+    last++;
+  }
+  // unchanged lines before the edit map to HEAD by the offset left behind by the hunk before them
+  int64_t offset = 0;
+  if (first > 0) {
+    const LineHunk &previous = hunks[first - 1];
+    offset = (int64_t)(previous.old_start + previous.old_count) - (int64_t)(previous.new_start + previous.new_count);
+  }
+  // the edited rows together with the hunks they touch, as a range of current lines and of lines in HEAD
+  size_t new_start = first_row;
+  size_t new_end = last_row + 1;
+  size_t old_start = first_row + offset;
+  size_t old_end = new_end + offset;
+  if (first < last) {
+    const LineHunk &first_hunk = hunks[first];
+    const LineHunk &last_hunk = hunks[last - 1];
+    if (first_hunk.new_start <= new_start) {
+      new_start = first_hunk.new_start;
+      old_start = first_hunk.old_start;
+    }
+    const size_t last_hunk_end = last_hunk.new_start + last_hunk.new_count;
+    if (last_hunk_end >= new_end) {
+      new_end = last_hunk_end;
+      old_end = last_hunk.old_start + last_hunk.old_count;
+    } else {
+      old_end = new_end + (int64_t)(last_hunk.old_start + last_hunk.old_count) - (int64_t)last_hunk_end;
+    }
+  }
+  const LineHunk merged = {old_start, old_end - old_start, new_start, (size_t)((int64_t)(new_end - new_start) + delta), true};
+  hunks.erase(hunks.begin() + first, hunks.begin() + last);
+  hunks.insert(hunks.begin() + first, merged);
+  if (delta != 0) {
+    for (size_t i = first + 1; i < hunks.size(); i++) {
+      hunks[i].new_start += delta;
+    }
+  }
+}
+
+void LineDiff::update(const std::vector<std::u16string> &head_lines, const std::function<std::u16string(size_t)> &line_for_row) {
+  if (!valid) return;
+  std::vector<LineHunk> result;
+  result.reserve(hunks.size());
+  for (const LineHunk &hunk : hunks) {
+    if (!hunk.dirty) {
+      result.push_back(hunk);
+      continue;
+    }
+    std::vector<std::u16string> new_lines;
+    new_lines.reserve(hunk.new_count);
+    for (size_t row = hunk.new_start; row < hunk.new_start + hunk.new_count; row++) {
+      new_lines.push_back(line_for_row(row));
+    }
+    for (const LineHunk &sub_hunk : diff_lines(head_lines.data() + hunk.old_start, hunk.old_count, new_lines.data(), new_lines.size())) {
+      result.push_back({hunk.old_start + sub_hunk.old_start, sub_hunk.old_count, hunk.new_start + sub_hunk.new_start, sub_hunk.new_count, false});
+    }
+  }
+  hunks = std::move(result);
+  change_count = 0;
+}
+
+const std::vector<LineHunk> &LineDiff::get_hunks() const {
+  return hunks;
+}
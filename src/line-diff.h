@@ -0,0 +1,41 @@
+#ifndef LINE_DIFF_H_
+#define LINE_DIFF_H_
+
+#include "buffer-change.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// old_count lines starting at old_start were replaced by new_count lines starting at new_start
+struct LineHunk {
+  size_t old_start;
+  size_t old_count;
+  size_t new_start;
+  size_t new_count;
+  // set for hunks that were touched by an edit and have to be diffed again
+  bool dirty;
+};
+
+// the hunks that turn the old lines into the new lines
+std::vector<LineHunk> diff_lines(const std::u16string *old_lines, size_t old_count, const std::u16string *new_lines, size_t new_count);
+
+// the differences between the lines of a file in HEAD and the lines of the buffer, kept up to date
+// across edits. an edit merges the hunks it touches into one dirty hunk and only moves the ones after
+// it, so that only the dirty hunks have to be diffed again
+class LineDiff {
+  std::vector<LineHunk> hunks;
+  size_t change_count;
+  bool valid;
+public:
+  LineDiff();
+  void set_hunks(std::vector<LineHunk> &&);
+  // false once more edits were recorded than are worth following, the whole text has to be diffed then
+  bool is_valid() const;
+  void invalidate();
+  void add_change(const BufferChange &);
+  // diffs the dirty hunks again, reading only their lines from the buffer
+  void update(const std::vector<std::u16string> &head_lines, const std::function<std::u16string(size_t)> &line_for_row);
+  const std::vector<LineHunk> &get_hunks() const;
+};
+
+#endif  // LINE_DIFF_H_
@@ -0,0 +1,65 @@
+#include "multi-cursor-edit.h"
+#include <text-editor.h>
+#include <algorithm>
+#include <vector>
+
+static bool is_before(const Point &lhs, const Point &rhs) {
+  return lhs.row < rhs.row || (lhs.row == rhs.row && lhs.column < rhs.column);
+}
+
+// newlines are indented and brackets and quotes are paired by the bracket matcher
+static bool is_plain_text(const std::u16string &text) {
+  if (text.empty()) return false;
+  for (char16_t c : text) {
+    switch (c) {
+      case u'\n':
+      case u'\r':
+      case u'(':
+      case u')':
+      case u'[':
+      case u']':
+      case u'{':
+      case u'}':
+      case u'"':
+      case u'\'':
+      case u'`':
+        return false;
+    }
+  }
+  return true;
+}
+
+bool insert_text_at_selections(TextEditor *text_editor, const std::u16string &text) {
+  if (!is_plain_text(text)) return false;
+  TextBuffer *buffer = text_editor->getBuffer();
+  std::vector<Range> ranges = text_editor->getSelectedBufferRanges();
+  std::sort(ranges.begin(), ranges.end(), [](const Range &lhs, const Range &rhs) {
+    return is_before(lhs.start, rhs.start);
+  });
+  std::vector<Range> cursors;
+  cursors.reserve(ranges.size());
+  text_editor->transact(text_editor->getUndoGroupingInterval(), [&]() {
+    // from the last selection to the first so that the ranges before an edit stay valid,
+    // markers between the selections are left alone
+    for (size_t i = ranges.size(); i-- > 0;) {
+      buffer->setTextInRange(ranges[i], text);
+    }
+    // a cursor is moved by the edits before it, which all end on the row of the previous cursor
+    Point old_end(0, 0);
+    Point new_end(0, 0);
+    for (const Range &range : ranges) {
+      Point start = range.start;
+      if (start.row == old_end.row) {
+        start = Point(new_end.row, new_end.column + start.column - old_end.column);
+      } else {
+        start.row += new_end.row - old_end.row;
+      }
+      const Point cursor(start.row, start.column + text.size());
+      cursors.push_back(Range(cursor, cursor));
+      old_end = range.end;
+      new_end = cursor;
+    }
+    text_editor->setSelectedBufferRanges(cursors);
+  });
+  return true;
+}
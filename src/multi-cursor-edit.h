@@ -0,0 +1,13 @@
+#ifndef MULTI_CURSOR_EDIT_H_
+#define MULTI_CURSOR_EDIT_H_
+
+#include <string>
+
+class TextEditor;
+
+// inserts text in place of every selection in one transaction with a single selection
+// update at the end. only plain text on a single line is handled this way, returns false
+// for text that has to go through the bracket matcher
+bool insert_text_at_selections(TextEditor *, const std::u16string &);
+
+#endif  // MULTI_CURSOR_EDIT_H_
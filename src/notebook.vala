@@ -5,16 +5,36 @@ class Notebook : Gtk.Notebook {
     Object(show_border: false);
   }
 
-  public void append_tab(File? file = null) {
+  public void append_tab(File? file = null, int row = 0, int column = 0) {
+    var text_editor = insert_tab(file, -1, true);
+    if (row > 0 || column > 0) {
+      text_editor.set_cursor_buffer_position(row, column);
+    }
+  }
+
+  public unowned Atom.TextEditorWidget insert_tab(File? file, int position, bool current) {
     var container = new Atom.TextEditorContainer(file);
     var label = create_tab_label(container);
     label.show_all();
     container.show_all();
-    int index = append_page(container, label);
+    int index = insert_page(container, label, position);
     set_tab_reorderable(container, true);
     child_set_property(container, "tab-expand", true);
-    set_current_page(index);
-    container.get_text_editor().grab_focus();
+    if (current) {
+      set_current_page(index);
+      container.get_text_editor().grab_focus();
+    }
+    return container.get_text_editor();
+  }
+
+  public bool has_file(File file) {
+    for (int index = 0; index < get_n_pages(); index++) {
+      var tab_file = get_text_editor(index).get_file();
+      if (tab_file != null && tab_file.equal(file)) {
+        return true;
+      }
+    }
+    return false;
   }
 
   public bool save() {
@@ -25,6 +45,15 @@ class Notebook : Gtk.Notebook {
     get_current_text_editor().save_as(file);
   }
 
+  public void find() {
+    get_current_container().show_find_bar();
+  }
+
+  public void toggle_soft_wrap() {
+    var text_editor = get_current_text_editor();
+    text_editor.soft_wrapped = !text_editor.soft_wrapped;
+  }
+
   public void save_all() {
     for (int index = 0; index < get_n_pages(); index++) {
       get_text_editor(index).save();
@@ -60,11 +89,15 @@ class Notebook : Gtk.Notebook {
     return tab_label;
   }
 
+  private unowned Atom.TextEditorContainer get_current_container() {
+    return get_nth_page(get_current_page()) as unowned Atom.TextEditorContainer;
+  }
+
   private unowned Atom.TextEditorWidget get_current_text_editor() {
     return get_text_editor(get_current_page());
   }
 
-  private unowned Atom.TextEditorWidget get_text_editor(int index) {
+  public unowned Atom.TextEditorWidget get_text_editor(int index) {
     var container = get_nth_page(index) as unowned Atom.TextEditorContainer;
     return container.get_text_editor();
   }
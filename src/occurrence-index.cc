@@ -0,0 +1,162 @@
+#include "occurrence-index.h"
+#include <text-buffer.h>
+#include <algorithm>
+
+// past this many edits searching the whole text again is cheaper than following them
+#define MAX_PENDING_CHANGES 256
+
+static int compare_points(const Point &lhs, const Point &rhs) {
+  if (lhs.row != rhs.row) {
+    return lhs.row < rhs.row ? -1 : 1;
+  }
+  if (lhs.column != rhs.column) {
+    return lhs.column < rhs.column ? -1 : 1;
+  }
+  return 0;
+}
+
+static std::vector<Range>::iterator first_starting_at(std::vector<Range> &ranges, const Point &position) {
+  return std::lower_bound(ranges.begin(), ranges.end(), position, [](const Range &range, const Point &position) {
+    return compare_points(range.start, position) < 0;
+  });
+}
+
+OccurrenceIndex::OccurrenceIndex() : whole_word(false), valid(false), selection_valid(false) {}
+
+void OccurrenceIndex::add_change(const BufferChange &change) {
+  if (!valid) return;
+  if (changes.size() >= MAX_PENDING_CHANGES) {
+    valid = false;
+    changes.clear();
+    return;
+  }
+  changes.push_back(change);
+}
+
+void OccurrenceIndex::rebuild(TextBuffer *buffer) {
+  ranges.clear();
+  search->search(buffer->getText(), NULL, [&](std::vector<Range> &&batch) {
+    ranges.insert(ranges.end(), batch.begin(), batch.end());
+  });
+}
+
+void OccurrenceIndex::apply_changes(TextBuffer *buffer) {
+  DirtyRows dirty;
+  for (const BufferChange &change : changes) {
+    dirty.add(change);
+    // occurrences before the edit stay, the ones after it move along and the ones it touched are
+    // dropped, the touched rows are searched again below
+    auto first = std::lower_bound(ranges.begin(), ranges.end(), change.old_range.start, [](const Range &range, const Point &position) {
+      return compare_points(range.end, position) <= 0;
+    });
+    auto last = first;
+    while (last != ranges.end() && compare_points(last->start, change.old_range.end) < 0) {
+      ++last;
+    }
+    for (auto iterator = last; iterator != ranges.end(); ++iterator) {
+      *iterator = Range(shift_point(iterator->start, change), shift_point(iterator->end, change));
+    }
+    ranges.erase(first, last);
+  }
+  changes.clear();
+  // a match is searched again if it could touch a dirty row, so windows are widened by the rows it spans
+  const double span = std::count(text.begin(), text.end(), u'\n');
+  const double last_row = buffer->getLastRow();
+  std::vector<std::pair<double, double>> windows;
+  for (const auto &interval : dirty.get()) {
+    const double start = std::max(0.0, interval.first - span);
+    const double end = std::min(last_row, interval.second + span);
+    if (start > end) continue;
+    if (!windows.empty() && start <= windows.back().second + 1) {
+      windows.back().second = std::max(windows.back().second, end);
+    } else {
+      windows.push_back({start, end});
+    }
+  }
+  for (const auto &window : windows) {
+    const Range window_range(Point(window.first, 0), Point(window.second, buffer->lineLengthForRow(window.second)));
+    std::vector<Range> found;
+    search->search(buffer->getTextInRange(window_range), NULL, [&](std::vector<Range> &&batch) {
+      for (const Range &range : batch) {
+        found.push_back(Range(Point(range.start.row + window.first, range.start.column), Point(range.end.row + window.first, range.end.column)));
+      }
+    });
+    // the occurrences that lie entirely within the window are replaced by what was found in it
+    auto first = first_starting_at(ranges, window_range.start);
+    auto last = first;
+    while (last != ranges.end() && last->start.row <= window.second) {
+      if (last->end.row > window.second) {
+        found.push_back(*last);
+      }
+      ++last;
+    }
+    std::sort(found.begin(), found.end(), [](const Range &lhs, const Range &rhs) {
+      return compare_points(lhs.start, rhs.start) < 0;
+    });
+    const size_t index = ranges.erase(first, last) - ranges.begin();
+    ranges.insert(ranges.begin() + index, found.begin(), found.end());
+  }
+}
+
+const std::vector<Range> &OccurrenceIndex::update(TextBuffer *buffer, const std::u16string &text, bool whole_word) {
+  if (valid && this->whole_word == whole_word && this->text == text) {
+    if (!changes.empty()) {
+      apply_changes(buffer);
+      selection_valid = false;
+    }
+    return ranges;
+  }
+  this->text = text;
+  this->whole_word = whole_word;
+  if (whole_word) {
+    // whole words consist of word characters only, so escaping is not necessary
+    search.reset(new BufferSearch(u"(?<![\\p{L}\\p{N}_])" + text + u"(?![\\p{L}\\p{N}_])", true, true));
+  } else {
+    search.reset(new BufferSearch(text, false, true));
+  }
+  rebuild(buffer);
+  changes.clear();
+  valid = true;
+  selection_valid = false;
+  return ranges;
+}
+
+bool OccurrenceIndex::has_selection() const {
+  return selection_valid;
+}
+
+void OccurrenceIndex::set_selection(const std::vector<Range> &selections) {
+  selected.assign(ranges.size(), false);
+  for (const Range &selection : selections) {
+    auto iterator = first_starting_at(ranges, selection.start);
+    if (iterator != ranges.end() && compare_points(iterator->start, selection.start) == 0 && compare_points(iterator->end, selection.end) == 0) {
+      selected[iterator - ranges.begin()] = true;
+    }
+  }
+  selection_valid = true;
+}
+
+void OccurrenceIndex::clear_selection() {
+  selection_valid = false;
+}
+
+size_t OccurrenceIndex::find_unselected(const Point &position) const {
+  const size_t start = std::lower_bound(ranges.begin(), ranges.end(), position, [](const Range &range, const Point &position) {
+    return compare_points(range.start, position) < 0;
+  }) - ranges.begin();
+  for (size_t i = 0; i < ranges.size(); i++) {
+    const size_t index = (start + i) % ranges.size();
+    if (!selected[index]) {
+      return index;
+    }
+  }
+  return ranges.size();
+}
+
+void OccurrenceIndex::select(size_t index) {
+  selected[index] = true;
+}
+
+void OccurrenceIndex::select_all() {
+  selected.assign(ranges.size(), true);
+}
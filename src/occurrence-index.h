@@ -0,0 +1,43 @@
+#ifndef OCCURRENCE_INDEX_H_
+#define OCCURRENCE_INDEX_H_
+
+#include "buffer-change.h"
+#include "buffer-search.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+class TextBuffer;
+
+// the occurrences of the text that select-next extends the selection with. edits are
+// recorded as they happen and only the rows they touched are searched again the next
+// time the index is used. which occurrences are selected is kept alongside, so that
+// repeated presses of select-next don't have to look at every selection
+class OccurrenceIndex {
+  std::u16string text;
+  bool whole_word;
+  bool valid;
+  std::unique_ptr<BufferSearch> search;
+  std::vector<Range> ranges;
+  std::vector<bool> selected;
+  bool selection_valid;
+  std::vector<BufferChange> changes;
+  void rebuild(TextBuffer *);
+  void apply_changes(TextBuffer *);
+public:
+  OccurrenceIndex();
+  void add_change(const BufferChange &);
+  // the occurrences of text in the buffer, sorted by position
+  const std::vector<Range> &update(TextBuffer *, const std::u16string &text, bool whole_word);
+  // whether the selected occurrences are known, they are forgotten on every edit
+  bool has_selection() const;
+  void set_selection(const std::vector<Range> &);
+  void clear_selection();
+  // the first occurrence at or after position that is not selected, wrapping around.
+  // returns the number of occurrences if all of them are selected
+  size_t find_unselected(const Point &position) const;
+  void select(size_t);
+  void select_all();
+};
+
+#endif  // OCCURRENCE_INDEX_H_
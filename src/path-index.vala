@@ -0,0 +1,167 @@
+namespace Atom {
+
+// the relative paths of all files below a directory, built in the background and kept current with file monitors.
+// there is one monitor per directory, so their number is limited and the index is scanned again when it is used
+// while some directories are not watched
+class PathIndex : Object {
+  private const int MAX_MONITORS = 1024;
+
+  public bool ready { get; private set; default = false; }
+
+  // emitted whenever a scan has finished
+  public signal void updated();
+
+  private File root;
+  private Atom.FuzzyMatcher matcher = new Atom.FuzzyMatcher();
+  private HashTable<string, FileMonitor> monitors = new HashTable<string, FileMonitor>(str_hash, str_equal);
+  private bool incomplete = false;
+  private bool scanning = false;
+
+  public PathIndex(File root) {
+    this.root = root;
+    rescan();
+  }
+
+  // only scans again if changes might have been missed
+  public void refresh() {
+    if (incomplete && !scanning) {
+      rescan();
+    }
+  }
+
+  private void rescan() {
+    scanning = true;
+    new Thread<void>("path-index", () => {
+      var paths = new GenericArray<string>();
+      var directories = new GenericArray<File>();
+      var rules = new GenericArray<Atom.IgnoreRules?>();
+      scan(root, Atom.IgnoreRules.load(null, root), paths, directories, rules);
+      Idle.add(() => {
+        monitors.foreach_remove((directory, monitor) => {
+          monitor.cancel();
+          return true;
+        });
+        incomplete = false;
+        matcher.set_paths(paths.data);
+        for (int i = 0; i < directories.length; i++) {
+          watch(directories[i], rules[i]);
+        }
+        scanning = false;
+        ready = true;
+        updated();
+        return Source.REMOVE;
+      });
+    });
+  }
+
+  public string[] match(string query, int max_results) {
+    return matcher.match(query, max_results);
+  }
+
+  private void scan(File directory, Atom.IgnoreRules? rules, GenericArray<string> paths, GenericArray<File> directories, GenericArray<Atom.IgnoreRules?> directory_rules) {
+    directories.add(directory);
+    directory_rules.add(rules);
+    try {
+      var enumerator = directory.enumerate_children(FileAttribute.STANDARD_NAME + "," + FileAttribute.STANDARD_TYPE, FileQueryInfoFlags.NOFOLLOW_SYMLINKS);
+      FileInfo? info;
+      while ((info = enumerator.next_file()) != null) {
+        var child = directory.get_child(info.get_name());
+        var type = info.get_file_type();
+        if (is_ignored(child, type, rules)) {
+          continue;
+        }
+        if (type == FileType.DIRECTORY) {
+          scan(child, Atom.IgnoreRules.load(rules, child), paths, directories, directory_rules);
+        } else {
+          paths.add(root.get_relative_path(child));
+        }
+      }
+    } catch (Error e) {
+    }
+  }
+
+  private bool is_ignored(File file, FileType type, Atom.IgnoreRules? rules) {
+    string name = file.get_basename();
+    if (name == ".git") {
+      return true;
+    }
+    if (type != FileType.DIRECTORY && type != FileType.REGULAR) {
+      return true;
+    }
+    return rules != null && rules.is_ignored(file.get_path(), name, type == FileType.DIRECTORY);
+  }
+
+  private void watch(File directory, Atom.IgnoreRules? rules) {
+    if (monitors.size() >= MAX_MONITORS) {
+      incomplete = true;
+      return;
+    }
+    FileMonitor monitor;
+    try {
+      monitor = directory.monitor_directory(FileMonitorFlags.WATCH_MOVES);
+    } catch (Error e) {
+      incomplete = true;
+      return;
+    }
+    monitor.changed.connect((file, other_file, event) => {
+      switch (event) {
+        case FileMonitorEvent.CREATED:
+        case FileMonitorEvent.MOVED_IN:
+          add(file, rules);
+          break;
+        case FileMonitorEvent.DELETED:
+        case FileMonitorEvent.MOVED_OUT:
+          remove(file);
+          break;
+        case FileMonitorEvent.RENAMED:
+          remove(file);
+          add(other_file, rules);
+          break;
+        default:
+          break;
+      }
+    });
+    monitors[directory.get_path()] = monitor;
+  }
+
+  private void add(File file, Atom.IgnoreRules? rules) {
+    var type = file.query_file_type(FileQueryInfoFlags.NOFOLLOW_SYMLINKS);
+    if (is_ignored(file, type, rules)) {
+      return;
+    }
+    if (type == FileType.DIRECTORY) {
+      // new directories are rare and usually small, so they are scanned synchronously
+      var paths = new GenericArray<string>();
+      var directories = new GenericArray<File>();
+      var directory_rules = new GenericArray<Atom.IgnoreRules?>();
+      scan(file, Atom.IgnoreRules.load(rules, file), paths, directories, directory_rules);
+      foreach (unowned string path in paths.data) {
+        matcher.add_path(path);
+      }
+      for (int i = 0; i < directories.length; i++) {
+        watch(directories[i], directory_rules[i]);
+      }
+    } else {
+      matcher.add_path(root.get_relative_path(file));
+    }
+  }
+
+  private void remove(File file) {
+    string? path = root.get_relative_path(file);
+    if (path == null) {
+      return;
+    }
+    matcher.remove_path(path);
+    // stop watching the directory and everything below it
+    string prefix = file.get_path() + "/";
+    monitors.foreach_remove((directory, monitor) => {
+      if (directory == file.get_path() || directory.has_prefix(prefix)) {
+        monitor.cancel();
+        return true;
+      }
+      return false;
+    });
+  }
+}
+
+}
@@ -0,0 +1,216 @@
+namespace Atom {
+
+class ProjectSearch : Object {
+  private const int MAX_RESULTS = 10000;
+  private const int MAX_LINE_LENGTH = 300;
+  private const int BINARY_CHECK_LENGTH = 8000;
+
+  public class Result {
+    public File file;
+    public int row;
+    public int column;
+    public string line;
+  }
+
+  private class Task {
+    public File file;
+    public Atom.IgnoreRules? ignore_rules;
+    public bool is_directory;
+
+    public Task(File file, Atom.IgnoreRules? ignore_rules, bool is_directory) {
+      this.file = file;
+      this.ignore_rules = ignore_rules;
+      this.is_directory = is_directory;
+    }
+  }
+
+  public signal void results_found(GenericArray<Result> results);
+  public signal void finished(bool truncated);
+
+  private Regex regex;
+  private Regex raw_regex;
+  private Cancellable cancellable = new Cancellable();
+  private ThreadPool<Task>? thread_pool;
+  private int pending_tasks = 0;
+  private int result_count = 0;
+  private bool stopped = false;
+
+  public ProjectSearch(string pattern, bool use_regex, bool case_sensitive) throws RegexError {
+    var flags = RegexCompileFlags.MULTILINE | RegexCompileFlags.OPTIMIZE;
+    if (!case_sensitive) {
+      flags |= RegexCompileFlags.CASELESS;
+    }
+    string source = use_regex ? pattern : Regex.escape_string(pattern);
+    // valid UTF-8 is matched by characters, so case folding also works beyond ASCII
+    regex = new Regex(source, flags);
+    // files with invalid UTF-8 are matched by bytes instead of being skipped
+    raw_regex = new Regex(source, flags | RegexCompileFlags.RAW);
+  }
+
+  public void start(File directory) {
+    try {
+      thread_pool = new ThreadPool<Task>.with_owned_data((task) => {
+        run(task);
+      }, (int)get_num_processors(), false);
+    } catch (ThreadError e) {
+      finished(false);
+      return;
+    }
+    push(new Task(directory, Atom.IgnoreRules.load(null, directory), true));
+  }
+
+  public void cancel() {
+    stopped = true;
+    cancellable.cancel();
+  }
+
+  private void push(owned Task task) {
+    AtomicInt.inc(ref pending_tasks);
+    try {
+      thread_pool.add((owned)task);
+    } catch (ThreadError e) {
+      task_done();
+    }
+  }
+
+  // runs on the worker threads, directories fan out into one task per entry so the pool stays busy
+  private void run(owned Task task) {
+    if (!cancellable.is_cancelled()) {
+      if (task.is_directory) {
+        search_directory(task);
+      } else {
+        search_file(task);
+      }
+    }
+    task_done();
+  }
+
+  private void task_done() {
+    if (AtomicInt.dec_and_test(ref pending_tasks)) {
+      Idle.add(() => {
+        // the pool is freed on the main thread once all of its tasks have returned
+        thread_pool = null;
+        if (!stopped) {
+          finished(AtomicInt.get(ref result_count) >= MAX_RESULTS);
+        }
+        return Source.REMOVE;
+      });
+    }
+  }
+
+  private void search_directory(Task task) {
+    try {
+      var enumerator = task.file.enumerate_children(FileAttribute.STANDARD_NAME + "," + FileAttribute.STANDARD_TYPE, FileQueryInfoFlags.NOFOLLOW_SYMLINKS, cancellable);
+      FileInfo? info;
+      while ((info = enumerator.next_file(cancellable)) != null) {
+        unowned string name = info.get_name();
+        var type = info.get_file_type();
+        bool is_directory = type == FileType.DIRECTORY;
+        if (!is_directory && type != FileType.REGULAR) {
+          continue;
+        }
+        if (name == ".git") {
+          continue;
+        }
+        var child = task.file.get_child(name);
+        if (task.ignore_rules != null && task.ignore_rules.is_ignored(child.get_path(), name, is_directory)) {
+          continue;
+        }
+        if (is_directory) {
+          push(new Task(child, Atom.IgnoreRules.load(task.ignore_rules, child), true));
+        } else {
+          push(new Task(child, null, false));
+        }
+      }
+    } catch (Error e) {
+    }
+  }
+
+  private void search_file(Task task) {
+    MappedFile mapped_file;
+    try {
+      mapped_file = new MappedFile(task.file.get_path(), false);
+    } catch (FileError e) {
+      return;
+    }
+    var bytes = mapped_file.get_bytes();
+    unowned uint8[] data = bytes.get_data();
+    if (data.length == 0 || is_binary(data)) {
+      return;
+    }
+    unowned Regex file_regex = ((string)data).validate(data.length) ? regex : raw_regex;
+    var results = new GenericArray<Result>();
+    int row = 0;
+    int scanned = 0;
+    int line_start = 0;
+    int offset = 0;
+    MatchInfo match_info;
+    try {
+      while (offset <= data.length && file_regex.match_full((string)data, data.length, offset, 0, out match_info)) {
+        int match_start, match_end;
+        match_info.fetch_pos(0, out match_start, out match_end);
+        for (; scanned < match_start; scanned++) {
+          if (data[scanned] == '\n') {
+            row++;
+            line_start = scanned + 1;
+          }
+        }
+        int line_end = match_end;
+        while (line_end < data.length && data[line_end] != '\n') {
+          line_end++;
+        }
+        var result = new Result();
+        result.file = task.file;
+        result.row = row;
+        result.column = utf16_length(data[line_start:match_start]);
+        int line_length = int.min(line_end - line_start, MAX_LINE_LENGTH);
+        result.line = ((string)data[line_start:line_start + line_length]).make_valid(line_length).strip();
+        results.add(result);
+        if (AtomicInt.add(ref result_count, 1) + 1 >= MAX_RESULTS) {
+          cancellable.cancel();
+          break;
+        }
+        // only report the first match of every line
+        offset = line_end + 1;
+      }
+    } catch (RegexError e) {
+    }
+    if (results.length > 0) {
+      Idle.add(() => {
+        if (!stopped) {
+          results_found(results);
+        }
+        return Source.REMOVE;
+      });
+    }
+  }
+
+  private static bool is_binary(uint8[] data) {
+    for (int i = 0; i < data.length && i < BINARY_CHECK_LENGTH; i++) {
+      if (data[i] == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // the number of UTF-16 code units in data, which is how the buffer counts columns
+  private static int utf16_length(uint8[] data) {
+    int length = 0;
+    int index = 0;
+    while (index < data.length) {
+      unowned string remaining = (string)data[index:data.length];
+      unichar c = remaining.get_char_validated(data.length - index);
+      if (c == (unichar)(-1) || c == (unichar)(-2)) {
+        length++;
+        index++;
+        continue;
+      }
+      length += c < 0x10000 ? 1 : 2;
+      index += c.to_utf8(null);
+    }
+    return length;
+  }
+}
+
+}
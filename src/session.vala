@@ -0,0 +1,146 @@
+namespace Atom {
+
+// the open tabs of a window, stored as a serialized GVariant that is memory-mapped on restore
+class Session : Object {
+  private const uint32 VERSION = 1;
+  // version, current tab and for every tab its path, modification time, size, selections and first visible row
+  private const string TYPE = "(uua(sxta(dddd)d))";
+  private const string FILE_ATTRIBUTES = FileAttribute.TIME_MODIFIED + "," + FileAttribute.TIME_MODIFIED_USEC + "," + FileAttribute.STANDARD_SIZE;
+
+  private uint restore_source_id = 0;
+
+  // while the remaining tabs are being opened, the saved session still has all of them
+  public bool restoring {
+    get { return restore_source_id != 0; }
+  }
+
+  public static void save(Atom.Notebook notebook) {
+    var tabs = new VariantBuilder(new VariantType("a(sxta(dddd)d)"));
+    uint32 current = 0;
+    uint32 count = 0;
+    for (int index = 0; index < notebook.get_n_pages(); index++) {
+      unowned Atom.TextEditorWidget text_editor = notebook.get_text_editor(index);
+      // untitled tabs cannot be reopened
+      var file = text_editor.get_file();
+      if (file == null) {
+        continue;
+      }
+      FileInfo info;
+      try {
+        info = file.query_info(FILE_ATTRIBUTES, FileQueryInfoFlags.NONE);
+      } catch (Error e) {
+        continue;
+      }
+      var selections = new VariantBuilder(new VariantType("a(dddd)"));
+      double[] ranges = text_editor.get_selected_ranges();
+      for (int i = 0; i + 3 < ranges.length; i += 4) {
+        selections.add("(dddd)", ranges[i], ranges[i + 1], ranges[i + 2], ranges[i + 3]);
+      }
+      tabs.add("(sxt@a(dddd)d)", file.get_path(), get_modification_time(info), (uint64)info.get_size(), selections.end(), text_editor.get_scroll_row());
+      if (index == notebook.page) {
+        current = count;
+      }
+      count++;
+    }
+    var snapshot = new Variant("(uu@a(sxta(dddd)d))", VERSION, current, tabs.end());
+    string path = get_snapshot_path();
+    try {
+      DirUtils.create_with_parents(Path.get_dirname(path), 0700);
+      FileUtils.set_data(path, snapshot.get_data_as_bytes().get_data());
+    } catch (FileError e) {
+      warning("failed to save the session: %s", e.message);
+    }
+  }
+
+  // opens the current tab right away and the others one at a time while the main loop is idle,
+  // returns false if there was no current tab to restore
+  public bool restore(Atom.Notebook notebook) {
+    MappedFile mapped_file;
+    try {
+      mapped_file = new MappedFile(get_snapshot_path(), false);
+    } catch (FileError e) {
+      return false;
+    }
+    var snapshot = new Variant.from_bytes(new VariantType(TYPE), mapped_file.get_bytes(), false);
+    if (snapshot.get_child_value(0).get_uint32() != VERSION) {
+      return false;
+    }
+    uint32 current = snapshot.get_child_value(1).get_uint32();
+    var tabs = snapshot.get_child_value(2);
+    if (current >= tabs.n_children()) {
+      return false;
+    }
+    bool restored = restore_tab(notebook, tabs.get_child_value(current), 0, true);
+    size_t index = 0;
+    int position = 0;
+    restore_source_id = Idle.add(() => {
+      if (index == current) {
+        if (restored) {
+          position++;
+        }
+        index++;
+      }
+      if (index >= tabs.n_children()) {
+        restore_source_id = 0;
+        return Source.REMOVE;
+      }
+      if (restore_tab(notebook, tabs.get_child_value(index), position, false)) {
+        position++;
+      }
+      index++;
+      return Source.CONTINUE;
+    }, Priority.LOW);
+    return restored;
+  }
+
+  // stops opening tabs, for a window that is being closed
+  public void cancel_restore() {
+    if (restore_source_id != 0) {
+      Source.remove(restore_source_id);
+      restore_source_id = 0;
+    }
+  }
+
+  private static bool restore_tab(Atom.Notebook notebook, Variant tab, int position, bool current) {
+    var file = File.new_for_path(tab.get_child_value(0).get_string());
+    FileInfo info;
+    try {
+      info = file.query_info(FILE_ATTRIBUTES, FileQueryInfoFlags.NONE);
+    } catch (Error e) {
+      // the file no longer exists
+      return false;
+    }
+    // the tab was already opened to recover its unsaved changes
+    if (notebook.has_file(file)) {
+      return false;
+    }
+    unowned Atom.TextEditorWidget text_editor = notebook.insert_tab(file, position, current);
+    // the selections and the scroll position are only meaningful if the file did not change
+    if (get_modification_time(info) != tab.get_child_value(1).get_int64() || info.get_size() != tab.get_child_value(2).get_uint64()) {
+      return true;
+    }
+    var selections = tab.get_child_value(3);
+    double[] ranges = new double[selections.n_children() * 4];
+    for (size_t i = 0; i < selections.n_children(); i++) {
+      double start_row, start_column, end_row, end_column;
+      selections.get_child(i, "(dddd)", out start_row, out start_column, out end_row, out end_column);
+      ranges[i * 4] = start_row;
+      ranges[i * 4 + 1] = start_column;
+      ranges[i * 4 + 2] = end_row;
+      ranges[i * 4 + 3] = end_column;
+    }
+    text_editor.set_selected_ranges(ranges);
+    text_editor.set_scroll_row(tab.get_child_value(4).get_double());
+    return true;
+  }
+
+  private static int64 get_modification_time(FileInfo info) {
+    return (int64)info.get_attribute_uint64(FileAttribute.TIME_MODIFIED) * 1000000 + info.get_attribute_uint32(FileAttribute.TIME_MODIFIED_USEC);
+  }
+
+  private static string get_snapshot_path() {
+    return Path.build_filename(Environment.get_user_cache_dir(), "atom", "session");
+  }
+}
+
+}
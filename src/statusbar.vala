@@ -53,6 +53,39 @@ class Statusbar : Gtk.Box {
     });
     pack_start(pack(selection_count_label), false);
 
+    var progress_bar = new Gtk.ProgressBar();
+    progress_bar.valign = Gtk.Align.CENTER;
+    text_editor_widget.bind_property("progress", progress_bar, "fraction", BindingFlags.SYNC_CREATE);
+    var progress_frame = pack(progress_bar);
+    progress_frame.show_all();
+    progress_frame.no_show_all = true;
+    text_editor_widget.bind_property("progress", progress_frame, "visible", BindingFlags.SYNC_CREATE, (binding, from_value, ref to_value) => {
+      to_value = (double)from_value > 0.0;
+      return true;
+    });
+    pack_start(progress_frame, false);
+
+    // large files open with the expensive features turned off, each of them can be turned back on here
+    var degraded_box = new Gtk.Box(Gtk.Orientation.VERTICAL, 0);
+    degraded_box.margin = 6;
+    degraded_box.add(feature_button(text_editor_widget, "highlighting", "Syntax Highlighting", true));
+    degraded_box.add(feature_button(text_editor_widget, "token-styling", "Token Styling", false));
+    degraded_box.add(feature_button(text_editor_widget, "bracket-matching", "Bracket Matching", false));
+    degraded_box.add(feature_button(text_editor_widget, "whitespace-handling", "Whitespace Handling", true));
+    degraded_box.show_all();
+    var degraded_popover = new Gtk.Popover(null);
+    degraded_popover.add(degraded_box);
+    var degraded_button = new Gtk.MenuButton();
+    degraded_button.relief = Gtk.ReliefStyle.NONE;
+    degraded_button.label = "Large File";
+    degraded_button.tooltip_text = "Some features are turned off to keep this file responsive";
+    degraded_button.popover = degraded_popover;
+    var degraded_frame = pack(degraded_button);
+    degraded_frame.show_all();
+    degraded_frame.no_show_all = true;
+    text_editor_widget.bind_property("degraded", degraded_frame, "visible", BindingFlags.SYNC_CREATE);
+    pack_start(degraded_frame, false);
+
     var grammar_label = new Gtk.Label(null);
     text_editor_widget.bind_property("grammar", grammar_label, "label", BindingFlags.SYNC_CREATE);
     text_editor_widget.bind_property("grammar", grammar_label, "tooltip-text", BindingFlags.SYNC_CREATE, (binding, from_value, ref to_value) => {
@@ -79,6 +112,16 @@ class Statusbar : Gtk.Box {
     return frame;
   }
 
+  // features that cannot be turned off again become insensitive once they are on
+  private static Gtk.Widget feature_button(Atom.TextEditorWidget text_editor_widget, string property, string label, bool irreversible) {
+    var button = new Gtk.CheckButton.with_label(label);
+    text_editor_widget.bind_property(property, button, "active", BindingFlags.BIDIRECTIONAL | BindingFlags.SYNC_CREATE);
+    if (irreversible) {
+      text_editor_widget.bind_property(property, button, "sensitive", BindingFlags.SYNC_CREATE | BindingFlags.INVERT_BOOLEAN);
+    }
+    return button;
+  }
+
   private static string pluralize(int count, string singular) {
     if (count == 1) {
       return "%d %s".printf(count, singular);
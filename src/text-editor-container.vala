@@ -2,6 +2,7 @@ namespace Atom {
 
 class TextEditorContainer : Gtk.Box {
   private Atom.TextEditorWidget text_editor_widget;
+  private Atom.FindBar find_bar;
 
   public TextEditorContainer(File? file = null) {
     Object(orientation: Gtk.Orientation.VERTICAL);
@@ -10,10 +11,16 @@ class TextEditorContainer : Gtk.Box {
     text_editor_widget = new Atom.TextEditorWidget(file);
     scrolled_window.add(text_editor_widget);
     pack_start(scrolled_window, true);
+    find_bar = new Atom.FindBar(text_editor_widget);
+    pack_start(find_bar, false);
     var status_bar = new Atom.Statusbar(text_editor_widget);
     pack_start(status_bar, false);
   }
 
+  public void show_find_bar() {
+    find_bar.show_bar();
+  }
+
   public unowned Atom.TextEditorWidget get_text_editor() {
     return text_editor_widget;
   }
@@ -1,5 +1,13 @@
 #include "text-editor-widget.h"
 #include "layout-cache.h"
+#include "lazy-grammars.h"
+#include "buffer-search.h"
+#include "buffer-change.h"
+#include "bracket-index.h"
+#include "journal.h"
+#include "line-diff.h"
+#include "multi-cursor-edit.h"
+#include "occurrence-index.h"
 #include <grammar-registry.h>
 #include <grammar.h>
 #include <text-editor.h>
@@ -10,20 +18,17 @@
 #include <clipboard.h>
 #include <match-manager.h>
 #include <bracket-matcher.h>
-#include <bracket-matcher-view.h>
 #include <select-next.h>
 #include <whitespace.h>
 #include <fs-plus.h>
-
-extern "C" TreeSitterGrammar *atom_language_c();
-extern "C" TreeSitterGrammar *atom_language_cpp();
-extern "C" TreeSitterGrammar *atom_language_css();
-extern "C" TreeSitterGrammar *atom_language_go();
-extern "C" TreeSitterGrammar *atom_language_html();
-extern "C" TreeSitterGrammar *atom_language_javascript();
-extern "C" TreeSitterGrammar *atom_language_json();
-extern "C" TreeSitterGrammar *atom_language_python();
-extern "C" TreeSitterGrammar *atom_language_rust();
+#include <glib/gstdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 
 #if !GLIB_CHECK_VERSION(2, 73, 2)
 #define G_CONNECT_DEFAULT ((GConnectFlags)0)
@@ -31,7 +36,30 @@ extern "C" TreeSitterGrammar *atom_language_rust();
 
 #define LINE_HEIGHT_FACTOR 1.5
 #define CURSOR_BLINK_PERIOD 800
-
+#define GUTTER_ALPHA 0.6
+#define PASTE_CHUNK_SIZE (1 << 18)
+#define FIND_DELAY 100
+#define GIT_DIFF_DELAY 200
+#define DEFERRED_PARSE_LENGTH (1 << 18)
+#define DEGRADED_MODE_LENGTH (1 << 24)
+#define JOURNAL_DELAY 1000
+// the journal is compacted once the text has not changed for this long
+#define JOURNAL_COMPACT_DELAY 10000
+// longer buffers are never copied for compaction, their journal grows until the next save
+#define JOURNAL_COMPACT_MAX_LENGTH (1 << 24)
+#define HIGHLIGHT_CACHE_ROWS 256
+#define HIGHLIGHT_CACHE_MAGIC 0x43485441
+// bump when the bundled grammars or the cache format change
+#define HIGHLIGHT_CACHE_VERSION 2
+// the least recently used files are removed once the cache grows past this size
+#define HIGHLIGHT_CACHE_MAX_SIZE (64 << 20)
+#define DEGRADED_MODE_LINE_LENGTH 10000
+#define LAYOUT_SEGMENT_LENGTH 4096
+#define BRACKET_ROWS_PER_FRAME 1000
+// the characters around a match that the replacement is expanded with
+#define SUBSTITUTE_CONTEXT_LENGTH 256
+
+static void atom_text_editor_widget_dispose(GObject *);
 static void atom_text_editor_widget_finalize(GObject *);
 static void atom_text_editor_widget_set_property(GObject *, guint, const GValue *, GParamSpec *);
 static void atom_text_editor_widget_get_property(GObject *, guint, GValue *, GParamSpec *);
@@ -41,8 +69,12 @@ static void atom_text_editor_widget_size_allocate(GtkWidget *, GtkAllocation *);
 static gboolean atom_text_editor_widget_focus_in_event(GtkWidget *, GdkEventFocus *);
 static gboolean atom_text_editor_widget_focus_out_event(GtkWidget *, GdkEventFocus *);
 static void get_style_property_for_path(GtkWidget *, const std::vector<std::string> &, const gchar *, GValue *);
-static PangoLayout *create_layout(AtomTextEditorWidget *, const DisplayLayer::ScreenLine &);
-static PangoLayout *create_layout(AtomTextEditorWidget *, double);
+static const std::vector<int32_t> *get_line_tags(AtomTextEditorWidget *, const DisplayLayer::ScreenLine &, bool &);
+static bool is_open_tag(AtomTextEditorWidget *, int32_t, bool);
+static bool is_close_tag(AtomTextEditorWidget *, int32_t, bool);
+static PangoLayout *create_layout(AtomTextEditorWidget *, const std::u16string &, const std::vector<int32_t> *, bool);
+static PangoLayout *create_layout(AtomTextEditorWidget *, int);
+static double get_char_width(AtomTextEditorWidget *);
 static gboolean atom_text_editor_widget_draw(GtkWidget *, cairo_t *);
 static gboolean atom_text_editor_widget_key_press_event(GtkWidget *, GdkEventKey *);
 static gboolean atom_text_editor_widget_key_release_event(GtkWidget *, GdkEventKey *);
@@ -51,6 +83,9 @@ static void atom_text_editor_widget_handle_pressed(GtkGestureMultiPress *, gint,
 static void atom_text_editor_widget_handle_released(GtkGestureMultiPress *, gint, gdouble, gdouble, gpointer);
 static void atom_text_editor_widget_handle_drag_update(GtkGestureDrag *, gdouble, gdouble, gpointer);
 static void update(AtomTextEditorWidget *, bool = true);
+static double get_screen_line_count(AtomTextEditorWidget *);
+static void apply_soft_wrap(AtomTextEditorWidget *);
+static void queue_update(AtomTextEditorWidget *, guint);
 static void autoscroll(AtomTextEditorWidget *, const Range &);
 static void start_blinking(AtomTextEditorWidget *);
 static void stop_blinking(AtomTextEditorWidget *);
@@ -91,6 +126,11 @@ static void atom_text_editor_widget_consolidate_selections(AtomTextEditorWidget
 static void atom_text_editor_widget_add_selection_above(AtomTextEditorWidget *);
 static void atom_text_editor_widget_add_selection_below(AtomTextEditorWidget *);
 static void atom_text_editor_widget_select_next(AtomTextEditorWidget *);
+static void atom_text_editor_widget_select_all_occurrences(AtomTextEditorWidget *);
+static void select_next_occurrence(AtomTextEditorWidget *);
+static void restart_search(AtomTextEditorWidget *);
+static void load_git_head(AtomTextEditorWidget *);
+static void schedule_git_diff(AtomTextEditorWidget *, guint);
 static void atom_text_editor_widget_insert_newline(AtomTextEditorWidget *);
 static void atom_text_editor_widget_insert_newline_above(AtomTextEditorWidget *);
 static void atom_text_editor_widget_insert_newline_below(AtomTextEditorWidget *);
@@ -108,6 +148,11 @@ static void atom_text_editor_widget_move_line_up(AtomTextEditorWidget *);
 static void atom_text_editor_widget_move_line_down(AtomTextEditorWidget *);
 static void atom_text_editor_widget_undo(AtomTextEditorWidget *);
 static void atom_text_editor_widget_redo(AtomTextEditorWidget *);
+static void update_primary_selection(AtomTextEditorWidget *);
+static void finish_paste(AtomTextEditorWidget *);
+static void cancel_paste(AtomTextEditorWidget *);
+static gboolean replace_ranges(AtomTextEditorWidget *, const std::vector<Range> &, const std::u16string &);
+static void free_paste_job(AtomTextEditorWidget *, bool);
 static void atom_text_editor_widget_copy(AtomTextEditorWidget *);
 static void atom_text_editor_widget_cut(AtomTextEditorWidget *);
 static void atom_text_editor_widget_paste(AtomTextEditorWidget *);
@@ -115,6 +160,32 @@ static void atom_text_editor_widget_paste(AtomTextEditorWidget *);
 static GrammarRegistry grammar_registry;
 static Whitespace whitespace;
 
+static void add_grammars_for_file(const gchar *path, TextBuffer *buffer) {
+  std::string basename;
+  std::string extension;
+  if (path) {
+    gchar *name = g_path_get_basename(path);
+    basename = name;
+    g_free(name);
+    const size_t dot = basename.rfind('.');
+    if (dot != std::string::npos) {
+      gchar *lowercase = g_ascii_strdown(basename.c_str() + dot + 1, -1);
+      extension = lowercase;
+      g_free(lowercase);
+    }
+  }
+  const std::u16string line = buffer->lineForRow(0);
+  gchar *first_line = g_utf16_to_utf8((const gunichar2 *)line.c_str(), std::min<size_t>(line.size(), 256), NULL, NULL, NULL);
+  for (size_t i = 0; i < lazy_grammar_count; i++) {
+    LazyGrammar &lazy_grammar = lazy_grammars[i];
+    if (!lazy_grammar.added && lazy_grammar_matches(lazy_grammar, basename, extension, first_line)) {
+      grammar_registry.addGrammar(lazy_grammar.create());
+      lazy_grammar.added = true;
+    }
+  }
+  g_free(first_line);
+}
+
 // convert between UTF-8 pointers and UTF-16 offsets
 static const gchar *offset_to_pointer(const gchar *str, glong offset) {
   while (offset > 0) {
@@ -132,54 +203,197 @@ static glong pointer_to_offset(const gchar *str, const gchar *pos) {
   return offset;
 }
 
-class Layout {
-  PangoLayout *layout;
+// convert UTF-16 to UTF-8 in fixed size pieces so that no temporary copy of the
+// whole text is needed besides the result
+static gchar *utf16_to_utf8_chunked(const std::u16string &text) {
+  GString *result = g_string_sized_new(text.size());
+  for (size_t start = 0; start < text.size();) {
+    size_t end = std::min(start + PASTE_CHUNK_SIZE, text.size());
+    // do not split a surrogate pair
+    if (end < text.size() && text[end] >= 0xDC00 && text[end] <= 0xDFFF) {
+      end--;
+    }
+    glong length;
+    gchar *utf8 = g_utf16_to_utf8((const gunichar2 *)text.c_str() + start, end - start, NULL, &length, NULL);
+    if (utf8) {
+      g_string_append_len(result, utf8, length);
+      g_free(utf8);
+    }
+    start = end;
+  }
+  return g_string_free(result, FALSE);
+}
+
+// a piece of a line that is laid out on its own
+class LayoutSegment {
 public:
-  Layout(AtomTextEditorWidget *self, const DisplayLayer::ScreenLine &screen_line) {
-    layout = create_layout(self, screen_line);
+  PangoLayout *layout;
+  explicit LayoutSegment(PangoLayout *layout) : layout(layout) {}
+  LayoutSegment(AtomTextEditorWidget *self, const std::u16string &text, const std::vector<int32_t> &tags, bool cached) {
+    layout = create_layout(self, text, tags.empty() ? NULL : &tags, cached);
+  }
+  LayoutSegment(const LayoutSegment &) = delete;
+  ~LayoutSegment() {
+    g_object_unref(layout);
   }
-  Layout(AtomTextEditorWidget *self, double row) {
-    layout = create_layout(self, row);
+};
+
+static std::shared_ptr<LayoutSegment> get_layout_segment(AtomTextEditorWidget *, std::u16string &&, std::vector<int32_t> &&, bool);
+
+// lines longer than LAYOUT_SEGMENT_LENGTH are split into segments that are shaped the first time
+// they are drawn or measured, each one placed at the measured end of the one before. the segments
+// come from the layout cache by their text and tags, so after an edit only the segments whose
+// text changed are shaped and measured again
+class Layout {
+  struct Segment {
+    // only kept until the segment is looked up, the tags start with the ones that are open at its start
+    std::u16string text;
+    std::vector<int32_t> tags;
+    std::shared_ptr<LayoutSegment> shaped;
+  };
+  struct Line {
+    AtomTextEditorWidget *self;
+    // whether the tags are the ones of the highlight cache
+    bool cached;
+    // the UTF-16 offset of each segment followed by the line length
+    std::vector<int32_t> starts;
+    std::vector<Segment> segments;
+    // the x of each segment as far as the segments before it have been measured, followed by the width
+    std::vector<double> xs;
+  };
+  std::shared_ptr<Line> line;
+  PangoLayout *get_segment(size_t index) const {
+    Segment &segment = line->segments[index];
+    if (!segment.shaped) {
+      segment.shaped = get_layout_segment(line->self, std::move(segment.text), std::move(segment.tags), line->cached);
+    }
+    return segment.shaped->layout;
   }
-  Layout(const Layout &other) {
-    layout = other.layout;
-    g_object_ref(layout);
+  size_t get_segment_for_index(int32_t index) const {
+    const std::vector<int32_t> &starts = line->starts;
+    return std::upper_bound(starts.begin() + 1, starts.end() - 1, index) - starts.begin() - 1;
   }
-  ~Layout() {
-    g_object_unref(layout);
+  // measures the segments before the given one, up to the number of segments for the width
+  double get_segment_x(size_t segment) const {
+    std::vector<double> &xs = line->xs;
+    while (xs.size() <= segment) {
+      PangoRectangle extents;
+      pango_layout_line_get_extents(pango_layout_get_line_readonly(get_segment(xs.size() - 1), 0), NULL, &extents);
+      xs.push_back(xs.back() + pango_units_to_double(extents.width));
+    }
+    return xs[segment];
   }
-  Layout &operator =(const Layout &other) {
-    g_object_unref(layout);
-    layout = other.layout;
-    g_object_ref(layout);
-    return *this;
+  size_t get_segment_for_x(double x) const {
+    const std::vector<double> &xs = line->xs;
+    size_t segment = std::upper_bound(xs.begin() + 1, xs.end(), x) - xs.begin() - 1;
+    // x is past the measured segments, measure the following ones until one ends after x
+    while (segment + 1 == xs.size() && segment + 1 < line->segments.size() && get_segment_x(segment + 1) <= x) {
+      segment++;
+    }
+    return std::min(segment, line->segments.size() - 1);
   }
+public:
+  Layout(AtomTextEditorWidget *self, const DisplayLayer::ScreenLine &screen_line) : line(std::make_shared<Line>()) {
+    const std::u16string &text = screen_line.lineText;
+    const int32_t length = text.size();
+    line->self = self;
+    line->xs.push_back(0);
+    line->starts.push_back(0);
+    for (int32_t start = LAYOUT_SEGMENT_LENGTH; start < length; start += LAYOUT_SEGMENT_LENGTH) {
+      // never split a surrogate pair
+      if (text[start] >= 0xdc00 && text[start] <= 0xdfff) start--;
+      line->starts.push_back(start);
+    }
+    line->starts.push_back(length);
+    const std::vector<int32_t> *tags = get_line_tags(self, screen_line, line->cached);
+    if (line->starts.size() == 2) {
+      line->segments.push_back({{}, {}, std::make_shared<LayoutSegment>(create_layout(self, text, tags, line->cached))});
+      return;
+    }
+    line->segments.resize(line->starts.size() - 1);
+    for (size_t i = 0; i < line->segments.size(); i++) {
+      line->segments[i].text.assign(text, line->starts[i], line->starts[i + 1] - line->starts[i]);
+    }
+    if (!tags) return;
+    // the lengths are split at the segment boundaries and every segment reopens the tags that are open at its start
+    std::vector<int32_t> open_tags;
+    size_t segment = 0;
+    int32_t index = 0;
+    for (int32_t tag : *tags) {
+      if (is_open_tag(self, tag, line->cached)) {
+        open_tags.push_back(tag);
+        line->segments[segment].tags.push_back(tag);
+      } else if (is_close_tag(self, tag, line->cached)) {
+        if (!open_tags.empty()) open_tags.pop_back();
+        line->segments[segment].tags.push_back(tag);
+      } else {
+        for (int32_t remaining = tag; remaining > 0 && index < length;) {
+          const int32_t end = line->starts[segment + 1];
+          const int32_t part = std::min(remaining, end - index);
+          line->segments[segment].tags.push_back(part);
+          index += part;
+          remaining -= part;
+          if (index == end && segment + 1 < line->segments.size()) {
+            line->segments[++segment].tags = open_tags;
+          }
+        }
+      }
+    }
+  }
+  Layout(AtomTextEditorWidget *self, int glyph) : line(std::make_shared<Line>()) {
+    line->self = self;
+    line->cached = false;
+    line->starts = {0, 1};
+    line->xs.push_back(0);
+    line->segments.push_back({{}, {}, std::make_shared<LayoutSegment>(create_layout(self, glyph))});
+  }
+  // draws the whole line, only meant for short ones like the line number glyphs
   void draw(cairo_t *cr, double x, double y, bool align_right = false) const {
-    PangoLayoutLine *layout_line = pango_layout_get_line_readonly(layout, 0);
     if (align_right) {
-      PangoRectangle extents;
-      pango_layout_line_get_pixel_extents(layout_line, NULL, &extents);
-      x -= extents.width;
+      x -= get_width();
+    }
+    for (size_t segment = 0; segment < line->segments.size(); segment++) {
+      cairo_move_to(cr, x + get_segment_x(segment), y);
+      pango_cairo_show_layout_line(cr, pango_layout_get_line_readonly(get_segment(segment), 0));
+    }
+  }
+  // draws only the segments that intersect the visible horizontal range
+  void draw(cairo_t *cr, double x, double y, double visible_start, double visible_end) const {
+    for (size_t segment = get_segment_for_x(visible_start); segment < line->segments.size() && get_segment_x(segment) < visible_end; segment++) {
+      cairo_move_to(cr, x + get_segment_x(segment), y);
+      pango_cairo_show_layout_line(cr, pango_layout_get_line_readonly(get_segment(segment), 0));
     }
-    cairo_move_to(cr, x, y);
-    pango_cairo_show_layout_line(cr, layout_line);
+  }
+  // the segments of a long line that have not been measured yet are estimated from their length
+  double get_width() const {
+    if (line->segments.size() > 1) {
+      const size_t measured = line->xs.size() - 1;
+      return line->xs.back() + (line->starts.back() - line->starts[measured]) * get_char_width(line->self);
+    }
+    PangoRectangle extents;
+    pango_layout_line_get_pixel_extents(pango_layout_get_line_readonly(get_segment(0), 0), NULL, &extents);
+    return extents.width;
   }
   double index_to_x(int index) const {
+    const size_t segment = get_segment_for_index(index);
+    PangoLayout *layout = get_segment(segment);
     const char *text = pango_layout_get_text(layout);
-    index = offset_to_pointer(text, index) - text;
+    const int byte_index = offset_to_pointer(text, index - line->starts[segment]) - text;
     int x_pos;
-    pango_layout_line_index_to_x(pango_layout_get_line_readonly(layout, 0), index, false, &x_pos);
-    return pango_units_to_double(x_pos);
+    pango_layout_line_index_to_x(pango_layout_get_line_readonly(layout, 0), byte_index, false, &x_pos);
+    return get_segment_x(segment) + pango_units_to_double(x_pos);
   }
   int x_to_index(double x) const {
+    const size_t segment = get_segment_for_x(x);
+    PangoLayout *layout = get_segment(segment);
     int index, trailing;
-    pango_layout_line_x_to_index(pango_layout_get_line_readonly(layout, 0), pango_units_from_double(x), &index, &trailing);
+    pango_layout_line_x_to_index(pango_layout_get_line_readonly(layout, 0), pango_units_from_double(x - get_segment_x(segment)), &index, &trailing);
     const char *text = pango_layout_get_text(layout);
     const char *pointer = text + index;
     for (; trailing > 0; trailing--) {
       pointer = g_utf8_next_char(pointer);
     }
-    return pointer_to_offset(text, pointer);
+    return line->starts[segment] + pointer_to_offset(text, pointer);
   }
 };
 
@@ -246,6 +460,8 @@ class StyleCache {
   };
   std::unordered_map<Key, std::pair<Value, size_t>, Hash, Equal> cache;
   size_t generation = 0;
+  // assigning the path to a reused key does not allocate once its strings are large enough
+  Key lookup_key;
 public:
   void increment_generation() {
     generation++;
@@ -260,8 +476,9 @@ public:
     }
   }
   template <class T> void get_property(GtkWidget *widget, const std::vector<std::string> &path, const gchar *property, T *t) {
-    Key key{property, path};
-    auto iterator = cache.find(key);
+    lookup_key.property = property;
+    lookup_key.path = path;
+    auto iterator = cache.find(lookup_key);
     if (iterator != cache.end()) {
       iterator->second.second = generation;
       iterator->second.first.get(t);
@@ -269,7 +486,7 @@ public:
       Value value;
       get_style_property_for_path(widget, path, property, value.get());
       value.get(t);
-      cache.insert({key, {value, generation}});
+      cache.insert({lookup_key, {value, generation}});
     }
   }
 };
@@ -283,11 +500,132 @@ static int count_digits(int n) {
   return digits;
 }
 
+// a large paste that is inserted in chunks from an idle callback, either UTF-8 text from
+// another application or the UTF-16 text of the editor's own clipboard
+struct PasteJob {
+  gchar *utf8;
+  std::u16string utf16;
+  size_t position;
+  size_t length;
+  Point insertion_point;
+  size_t checkpoint;
+  guint source_id;
+  // the keys pressed while the paste runs, handled in order once it is done
+  std::vector<GdkEvent *> queued_events;
+};
+
+// the state of find and replace: matches are collected on a worker thread and
+// streamed into a marker layer, which keeps them up to date while editing
+struct FindState {
+  std::shared_ptr<BufferSearch> search;
+  DisplayMarkerLayer *marker_layer;
+  std::vector<DisplayMarker *> markers;
+  GCancellable *cancellable;
+  bool searching;
+  guint timeout_id;
+  // a replace all that waits for the search to find all matches
+  bool replace_all_pending;
+  std::u16string replacement;
+};
+
+// the markers found so far are kept, searching stays set since they are incomplete
+static void cancel_search(FindState *find) {
+  if (find->cancellable) {
+    g_cancellable_cancel(find->cancellable);
+    g_object_unref(find->cancellable);
+    find->cancellable = NULL;
+  }
+}
+
+enum GitLineStatus {
+  GIT_LINE_ADDED,
+  GIT_LINE_MODIFIED,
+  GIT_LINE_REMOVED,
+  GIT_LINE_STATUS_COUNT
+};
+
+struct GitState {
+  // the lines of the file in HEAD, shared with the diff worker
+  std::shared_ptr<const std::vector<std::u16string>> head_lines;
+  LineDiff diff;
+  // the edits made while the worker diffs the whole text, applied to its result
+  std::vector<BufferChange> changes;
+  DisplayMarkerLayer *marker_layers[GIT_LINE_STATUS_COUNT];
+  GCancellable *head_cancellable;
+  // set while the worker diffs the whole text
+  GCancellable *diff_cancellable;
+  guint timeout_id;
+};
+
+// the brackets outside of strings and comments. edits only mark their rows, which are tokenized
+// again before the next frame, with a limit on the rows per frame
+struct BracketState {
+  BracketIndex index;
+  DirtyRows dirty_rows;
+  DisplayMarkerLayer *marker_layer;
+  // the highlighted bracket at the cursor and its partner, which may have moved since an edit
+  bool highlighted;
+  bool edited;
+  Point position;
+  Point partner;
+};
+
+// the highlighting of the first rows of a large file, cached on disk by content hash so that
+// reopening the file shows colored text while it is parsed again. odd negative tags open
+// the class (-tag - 1) / 2, -2 closes the innermost class and other tags are text lengths
+struct HighlightCache {
+  gchar *path;
+  std::vector<std::string> classes;
+  std::unordered_map<std::u16string, std::vector<int32_t>> lines;
+  bool loaded;
+};
+
+static void free_highlight_cache(gpointer cache) {
+  g_free(((HighlightCache *)cache)->path);
+  delete (HighlightCache *)cache;
+}
+
+// the edits of the change feed are written to the journal in batches, see journal.h
+struct JournalState {
+  gchar *path;
+  JournalHeader header;
+  // the end of the text as it is on disk, which a compacted journal replaces
+  Point base_end;
+  // the records that have not been written yet
+  std::string records;
+  // the size of the journal on disk
+  size_t size;
+  guint timeout_id;
+  guint compact_id;
+  bool writing;
+  bool flush_pending;
+  bool reset_pending;
+};
+
+struct JournalWrite {
+  std::string path;
+  std::string data;
+  // whether data replaces the journal instead of being appended to it
+  bool replace;
+};
+
+// the per-frame data of draw, kept between frames so that a steady frame reuses its capacity
+struct FrameScratch {
+  std::vector<std::string> line_classes;
+  std::vector<std::string> gutter_classes;
+  std::vector<double> line_numbers;
+  std::vector<std::pair<Range, const char *>> highlights;
+  std::vector<std::pair<int32_t, int32_t>> cursors;
+  std::vector<Layout> layouts;
+  std::vector<std::string> gutter_path = {"gutter", ""};
+  std::vector<std::string> highlight_path = {"highlights", "", ""};
+  std::vector<std::string> line_path = {""};
+};
+
 typedef struct {
   TextEditor *text_editor;
   MatchManager *match_manager;
   BracketMatcher *bracket_matcher;
-  BracketMatcherView *bracket_matcher_view;
   SelectNext *select_next;
   GtkAdjustment *hadjustment;
   GtkAdjustment *vadjustment;
@@ -297,16 +635,56 @@ typedef struct {
   GtkIMContext *im_context;
   GtkGesture *multipress_gesture;
   GtkGesture *drag_gesture;
+  // owned by the font service
   PangoFontDescription *font_description;
   double ascent;
   double line_height;
   double char_width;
   bool draw_cursors;
   guint blink_source_id;
-  LayoutCache<AtomTextEditorWidget, Layout> *layout_cache;
+  LayoutCache<AtomTextEditorWidget, Layout, LayoutSegment> *layout_cache;
   StyleCache *style_cache;
   double gutter_width;
   Range initial_screen_range;
+  guint pending_updates;
+  guint tick_callback_id;
+  Range autoscroll_range;
+  // an autoscroll that waits for the widget to be allocated
+  bool autoscroll_pending;
+  double pending_scroll_row;
+  // the width of the widest line drawn in the last frame
+  double scroll_width;
+  Point cursor_position;
+  Range selected_range;
+  Range primary_range;
+  bool primary_range_changed;
+  std::u16string *primary_text;
+  PasteJob *paste_job;
+  guint language_mode_source_id;
+  guint prewarm_source_id;
+  // the visible rows that the layouts around them have been prepared for
+  double prewarmed_start_row;
+  double prewarmed_end_row;
+  bool degraded;
+  bool highlighting;
+  bool bracket_matching;
+  bool whitespace_handling;
+  bool token_styling;
+  bool soft_wrapped;
+  // the wrap column last passed to the text editor
+  double wrap_width_in_chars;
+  // the screen line count the vertical adjustment was last sized for
+  double screen_line_count;
+  FindState *find;
+  OccurrenceIndex *occurrences;
+  // set while select-next changes the selections itself
+  bool selecting_occurrences;
+  GitState *git;
+  BracketState *brackets;
+  HighlightCache *highlight_cache;
+  GCancellable *highlight_cache_cancellable;
+  JournalState *journal;
+  FrameScratch *frame;
 } AtomTextEditorWidgetPrivate;
 G_DEFINE_TYPE_WITH_CODE(AtomTextEditorWidget, atom_text_editor_widget, GTK_TYPE_WIDGET,
   G_ADD_PRIVATE(AtomTextEditorWidget)
@@ -315,6 +693,14 @@ G_DEFINE_TYPE_WITH_CODE(AtomTextEditorWidget, atom_text_editor_widget, GTK_TYPE_
 
 #define GET_PRIVATE(x) ((AtomTextEditorWidgetPrivate *)atom_text_editor_widget_get_instance_private(ATOM_TEXT_EDITOR_WIDGET(x)))
 
+typedef enum {
+  PENDING_UPDATE_CONTENT = 1 << 0,
+  PENDING_UPDATE_SELECTIONS = 1 << 1,
+  PENDING_UPDATE_AUTOSCROLL = 1 << 2,
+  PENDING_UPDATE_SCROLL_RANGE = 1 << 3,
+  PENDING_UPDATE_BRACKETS = 1 << 4
+} AtomTextEditorWidgetPendingUpdate;
+
 typedef enum {
   PROP_0,
   PROP_HADJUSTMENT,
@@ -327,49 +713,721 @@ typedef enum {
   PROP_CURSOR_POSITION,
   PROP_SELECTION_COUNT,
   PROP_GRAMMAR,
+  PROP_PROGRESS,
+  PROP_MATCH_COUNT,
+  PROP_DEGRADED,
+  PROP_HIGHLIGHTING,
+  PROP_BRACKET_MATCHING,
+  PROP_WHITESPACE_HANDLING,
+  PROP_TOKEN_STYLING,
+  PROP_SOFT_WRAPPED,
   N_PROPERTIES
 } AtomTextEditorWidgetProperty;
 
+// minified bundles and huge data files are opened with the expensive features turned off
+static bool is_large_file(TextBuffer *buffer) {
+  if (buffer->getLength() >= DEGRADED_MODE_LENGTH) return true;
+  const double line_count = buffer->getLineCount();
+  for (double row = 0; row < line_count; row++) {
+    if (buffer->lineLengthForRow(row) >= DEGRADED_MODE_LINE_LENGTH) return true;
+  }
+  return false;
+}
+
+static int compare_points(const Point &lhs, const Point &rhs) {
+  if (lhs.row != rhs.row) {
+    return lhs.row < rhs.row ? -1 : 1;
+  }
+  if (lhs.column != rhs.column) {
+    return lhs.column < rhs.column ? -1 : 1;
+  }
+  return 0;
+}
+
+static void mark_bracket_rows(BracketState *brackets, double start_row, double end_row) {
+  const Range range(Point(start_row, 0), Point(end_row, 0));
+  brackets->dirty_rows.add(BufferChange{range, range});
+}
+
+// the brackets of a buffer row going by the classes the syntax tree gives its screen lines, which
+// open every class the line starts in. also tells whether the row starts in a string or comment
+static std::vector<Bracket> tokenize_bracket_row(AtomTextEditorWidget *self, double row, bool &starts_in_skipped_scope) {
+  TextEditor *text_editor = GET_PRIVATE(self)->text_editor;
+  DisplayLayer *display_layer = text_editor->displayLayer;
+  std::vector<Bracket> brackets;
+  starts_in_skipped_scope = false;
+  bool started = false;
+  double screen_row = text_editor->screenPositionForBufferPosition(Point(row, 0)).row;
+  const double end_screen_row = text_editor->screenPositionForBufferPosition(Point(row, INFINITY)).row;
+  for (const DisplayLayer::ScreenLine &screen_line : display_layer->getScreenLines(screen_row, end_screen_row + 1)) {
+    std::vector<bool> skipped;
+    size_t skipped_count = 0;
+    size_t column = 0;
+    for (int32_t tag : screen_line.tags) {
+      if (!started && !display_layer->isOpenTag(tag)) {
+        started = true;
+        starts_in_skipped_scope = skipped_count > 0;
+      }
+      if (display_layer->isOpenTag(tag)) {
+        const std::string class_name = display_layer->classNameForTag(tag);
+        skipped.push_back(class_name.find("syntax--string") != std::string::npos || class_name.find("syntax--comment") != std::string::npos);
+        skipped_count += skipped.back();
+      } else if (display_layer->isCloseTag(tag)) {
+        if (skipped.empty()) continue;
+        skipped_count -= skipped.back();
+        skipped.pop_back();
+      } else {
+        const size_t end = std::min<size_t>(column + tag, screen_line.lineText.size());
+        for (; skipped_count == 0 && column < end; column++) {
+          const char16_t c = screen_line.lineText[column];
+          if (c != u'(' && c != u')' && c != u'[' && c != u']' && c != u'{' && c != u'}') continue;
+          // soft wrapped and folded lines do not start at the beginning of the row
+          const Point position = text_editor->bufferPositionForScreenPosition(Point(screen_row, column));
+          if (position.row == row) {
+            brackets.push_back({(uint32_t)position.column, c});
+          }
+        }
+        column = end;
+      }
+    }
+    if (!started) {
+      started = true;
+      starts_in_skipped_scope = skipped_count > 0;
+    }
+    screen_row++;
+  }
+  return brackets;
+}
+
+// tokenizes the marked rows and the rows after them until one is unchanged, since opening a
+// string or comment changes the rows that follow. returns whether rows are left for the next frame
+static bool update_bracket_index(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  BracketState *brackets = priv->brackets;
+  const std::vector<std::pair<double, double>> intervals = brackets->dirty_rows.get();
+  brackets->dirty_rows.clear();
+  const double last_row = priv->text_editor->getBuffer()->getLastRow();
+  size_t budget = BRACKET_ROWS_PER_FRAME;
+  for (const auto &interval : intervals) {
+    double row = interval.first;
+    bool changed = true;
+    for (; row <= last_row && budget > 0 && (row <= interval.second + 1 || changed); row++, budget--) {
+      bool starts_in_skipped_scope;
+      std::vector<Bracket> row_brackets = tokenize_bracket_row(self, row, starts_in_skipped_scope);
+      changed = brackets->index.set_row(row, std::move(row_brackets), starts_in_skipped_scope);
+    }
+    if (row <= last_row && (row <= interval.second + 1 || changed)) {
+      mark_bracket_rows(brackets, row, std::max(row, interval.second));
+    }
+  }
+  return !brackets->dirty_rows.empty();
+}
+
+static void update_bracket_matches(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  BracketState *brackets = priv->brackets;
+  bool highlighted = false;
+  Point position;
+  Point partner;
+  if (priv->bracket_matching) {
+    if (update_bracket_index(self)) {
+      queue_update(self, PENDING_UPDATE_BRACKETS);
+    } else {
+      // the bracket after the cursor takes precedence over the one before it
+      position = priv->text_editor->getCursorBufferPosition();
+      highlighted = brackets->index.find_partner(position, partner);
+      if (!highlighted && position.column > 0) {
+        position.column--;
+        highlighted = brackets->index.find_partner(position, partner);
+      }
+    }
+  }
+  if (!brackets->edited && highlighted == brackets->highlighted && (!highlighted || (compare_points(position, brackets->position) == 0 && compare_points(partner, brackets->partner) == 0))) return;
+  brackets->highlighted = highlighted;
+  brackets->edited = false;
+  brackets->position = position;
+  brackets->partner = partner;
+  brackets->marker_layer->clear();
+  if (highlighted) {
+    brackets->marker_layer->markBufferRange(Range(position, Point(position.row, position.column + 1)));
+    brackets->marker_layer->markBufferRange(Range(partner, Point(partner.row, partner.column + 1)));
+  }
+  gtk_widget_queue_draw(GTK_WIDGET(self));
+}
+
+// hashes the file and reads its cached highlighting on a worker thread, the file is opened as
+// plain text in the meantime
+static void load_highlight_cache_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+  const gchar *path = (const gchar *)task_data;
+  HighlightCache *cache = new HighlightCache();
+  cache->path = NULL;
+  cache->loaded = false;
+  GMappedFile *source_file = g_mapped_file_new(path, FALSE, NULL);
+  if (!source_file) {
+    g_task_return_pointer(task, cache, free_highlight_cache);
+    return;
+  }
+  // the grammar is chosen by the file name, so it is part of the key
+  gchar *basename = g_path_get_basename(path);
+  GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA256);
+  g_checksum_update(checksum, (const guchar *)basename, -1);
+  g_checksum_update(checksum, (const guchar *)g_mapped_file_get_contents(source_file), g_mapped_file_get_length(source_file));
+  cache->path = g_build_filename(g_get_user_cache_dir(), "atom", "highlights", g_checksum_get_string(checksum), NULL);
+  g_checksum_free(checksum);
+  g_free(basename);
+  g_mapped_file_unref(source_file);
+  GMappedFile *mapped_file = g_mapped_file_new(cache->path, FALSE, NULL);
+  if (!mapped_file) {
+    g_task_return_pointer(task, cache, free_highlight_cache);
+    return;
+  }
+  const gchar *data = g_mapped_file_get_contents(mapped_file);
+  const gchar *end = data + g_mapped_file_get_length(mapped_file);
+  auto read_uint32 = [&](uint32_t &value) {
+    if (end - data < (ptrdiff_t)sizeof(uint32_t)) return false;
+    memcpy(&value, data, sizeof(uint32_t));
+    data += sizeof(uint32_t);
+    return true;
+  };
+  uint32_t magic, version, class_count, line_count;
+  bool valid = read_uint32(magic) && magic == HIGHLIGHT_CACHE_MAGIC && read_uint32(version) && version == HIGHLIGHT_CACHE_VERSION && read_uint32(class_count);
+  for (uint32_t i = 0; valid && i < class_count; i++) {
+    uint32_t length;
+    valid = read_uint32(length) && end - data >= (ptrdiff_t)length;
+    if (valid) {
+      cache->classes.emplace_back(data, length);
+      data += length;
+    }
+  }
+  valid = valid && read_uint32(line_count);
+  for (uint32_t i = 0; valid && i < line_count; i++) {
+    uint32_t length, tag_count;
+    valid = read_uint32(length) && (size_t)(end - data) / sizeof(char16_t) >= length;
+    if (!valid) break;
+    std::u16string line((const char16_t *)data, length);
+    data += length * sizeof(char16_t);
+    valid = read_uint32(tag_count) && (size_t)(end - data) / sizeof(int32_t) >= tag_count;
+    if (!valid) break;
+    std::vector<int32_t> tags(tag_count);
+    memcpy(tags.data(), data, tag_count * sizeof(int32_t));
+    data += tag_count * sizeof(int32_t);
+    // drawing trusts the tags, so every class has to exist, be closed again and cover only the line
+    size_t depth = 0;
+    size_t text_length = 0;
+    for (int32_t tag : tags) {
+      if (tag < 0 && tag % 2 != 0) {
+        valid = valid && (uint32_t)((-tag - 1) / 2) < class_count;
+        depth++;
+      } else if (tag == -2) {
+        valid = valid && depth > 0;
+        depth--;
+      } else if (tag < 0) {
+        valid = false;
+      } else {
+        text_length += tag;
+      }
+      if (!valid) break;
+    }
+    valid = valid && depth == 0 && text_length <= length;
+    cache->lines[line] = std::move(tags);
+  }
+  g_mapped_file_unref(mapped_file);
+  if (valid) {
+    cache->loaded = true;
+    // the modification time orders the files for eviction
+    g_utime(cache->path, NULL);
+  } else {
+    cache->classes.clear();
+    cache->lines.clear();
+  }
+  g_task_return_pointer(task, cache, free_highlight_cache);
+}
+
+struct HighlightCacheWrite {
+  std::string path;
+  std::string data;
+};
+
+// removes the least recently used files until the cache fits in HIGHLIGHT_CACHE_MAX_SIZE
+static void evict_highlight_cache(const gchar *directory) {
+  GDir *dir = g_dir_open(directory, 0, NULL);
+  if (!dir) return;
+  // modification time, size and path of every file
+  std::vector<std::tuple<gint64, gint64, std::string>> files;
+  gint64 total_size = 0;
+  while (const gchar *name = g_dir_read_name(dir)) {
+    gchar *path = g_build_filename(directory, name, NULL);
+    GStatBuf stat_buffer;
+    if (g_stat(path, &stat_buffer) == 0 && S_ISREG(stat_buffer.st_mode)) {
+      files.emplace_back(stat_buffer.st_mtime, stat_buffer.st_size, path);
+      total_size += stat_buffer.st_size;
+    }
+    g_free(path);
+  }
+  g_dir_close(dir);
+  if (total_size <= HIGHLIGHT_CACHE_MAX_SIZE) return;
+  std::sort(files.begin(), files.end());
+  for (const auto &file : files) {
+    if (total_size <= HIGHLIGHT_CACHE_MAX_SIZE) break;
+    if (g_remove(std::get<2>(file).c_str()) == 0) {
+      total_size -= std::get<1>(file);
+    }
+  }
+}
+
+static void write_highlight_cache_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+  const HighlightCacheWrite *write = (const HighlightCacheWrite *)task_data;
+  gchar *directory = g_path_get_dirname(write->path.c_str());
+  // the file is replaced atomically, so a concurrent reader never sees it half written
+  if (g_mkdir_with_parents(directory, 0700) == 0 && g_file_set_contents(write->path.c_str(), write->data.data(), write->data.size(), NULL)) {
+    evict_highlight_cache(directory);
+  }
+  g_free(directory);
+}
+
+// called once the file has been parsed, replaces the cached highlighting if it changed
+static void save_highlight_cache(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  HighlightCache *cache = priv->highlight_cache;
+  if (!cache->path) return;
+  DisplayLayer *display_layer = priv->text_editor->displayLayer;
+  std::vector<std::string> classes;
+  std::unordered_map<std::string, int32_t> class_ids;
+  auto append_uint32 = [](std::string &data, uint32_t value) {
+    data.append((const char *)&value, sizeof(uint32_t));
+  };
+  std::unordered_map<std::u16string, std::vector<int32_t>> new_lines;
+  // lines are looked up by their text, one that is colored differently in different places, like
+  // code that is also commented out, is left out rather than colored wrongly in some of them
+  std::unordered_set<std::u16string> ambiguous_lines;
+  const double row_count = std::min<double>(HIGHLIGHT_CACHE_ROWS, get_screen_line_count(self));
+  for (const DisplayLayer::ScreenLine &screen_line : display_layer->getScreenLines(0, row_count)) {
+    if (ambiguous_lines.count(screen_line.lineText)) continue;
+    std::vector<int32_t> tags;
+    for (int32_t tag : screen_line.tags) {
+      if (display_layer->isOpenTag(tag)) {
+        const std::string class_name = display_layer->classNameForTag(tag);
+        auto iterator = class_ids.find(class_name);
+        if (iterator == class_ids.end()) {
+          iterator = class_ids.emplace(class_name, classes.size()).first;
+          classes.push_back(class_name);
+        }
+        tags.push_back(-(2 * iterator->second + 1));
+      } else if (display_layer->isCloseTag(tag)) {
+        tags.push_back(-2);
+      } else {
+        tags.push_back(tag);
+      }
+    }
+    auto iterator = new_lines.find(screen_line.lineText);
+    if (iterator == new_lines.end()) {
+      new_lines.emplace(screen_line.lineText, std::move(tags));
+    } else if (iterator->second != tags) {
+      ambiguous_lines.insert(screen_line.lineText);
+      new_lines.erase(iterator);
+    }
+  }
+  const bool changed = !cache->loaded || cache->classes != classes || cache->lines != new_lines;
+  cache->classes.clear();
+  cache->lines.clear();
+  if (!changed) return;
+  HighlightCacheWrite *write = new HighlightCacheWrite{cache->path, std::string()};
+  std::string &data = write->data;
+  append_uint32(data, HIGHLIGHT_CACHE_MAGIC);
+  append_uint32(data, HIGHLIGHT_CACHE_VERSION);
+  append_uint32(data, classes.size());
+  for (const std::string &class_name : classes) {
+    append_uint32(data, class_name.size());
+    data.append(class_name);
+  }
+  append_uint32(data, new_lines.size());
+  for (const auto &line : new_lines) {
+    append_uint32(data, line.first.size());
+    data.append((const char *)line.first.data(), line.first.size() * sizeof(char16_t));
+    append_uint32(data, line.second.size());
+    data.append((const char *)line.second.data(), line.second.size() * sizeof(int32_t));
+  }
+  GTask *task = g_task_new(NULL, NULL, NULL, NULL);
+  g_task_set_task_data(task, write, [](gpointer write) {
+    delete (HighlightCacheWrite *)write;
+  });
+  g_task_run_in_thread(task, write_highlight_cache_thread);
+  g_object_unref(task);
+}
+
+static gchar *get_journal_directory() {
+  return g_build_filename(g_get_user_cache_dir(), "atom", "journal", NULL);
+}
+
+static gchar *get_journal_path(const gchar *file_path) {
+  gchar *checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA256, file_path, -1);
+  gchar *directory = get_journal_directory();
+  gchar *path = g_build_filename(directory, checksum, NULL);
+  g_free(directory);
+  g_free(checksum);
+  return path;
+}
+
+static gint64 get_modification_time(const GStatBuf &stat_buffer) {
+  return (gint64)stat_buffer.st_mtim.tv_sec * 1000000000 + stat_buffer.st_mtim.tv_nsec;
+}
+
+// whether the file is still exactly as it was when the journal was started
+static bool journal_matches_file(const JournalHeader &header) {
+  GStatBuf stat_buffer;
+  return g_stat(header.file_path.c_str(), &stat_buffer) == 0 && get_modification_time(stat_buffer) == header.base_mtime && stat_buffer.st_size == header.base_size;
+}
+
+static void write_journal_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+  const JournalWrite *write = (const JournalWrite *)task_data;
+  if (write->replace) {
+    // a new or compacted journal replaces the old one atomically
+    gchar *directory = g_path_get_dirname(write->path.c_str());
+    if (g_mkdir_with_parents(directory, 0700) == 0) {
+      g_file_set_contents(write->path.c_str(), write->data.data(), write->data.size(), NULL);
+    }
+    g_free(directory);
+  } else if (FILE *file = g_fopen(write->path.c_str(), "ab")) {
+    fwrite(write->data.data(), 1, write->data.size(), file);
+    fflush(file);
+    fsync(fileno(file));
+    fclose(file);
+  }
+}
+
+static void flush_journal(AtomTextEditorWidget *);
+static void reset_journal(AtomTextEditorWidget *);
+
+static void write_journal_ready(GObject *source_object, GAsyncResult *result, gpointer user_data) {
+  AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(source_object);
+  JournalState *journal = GET_PRIVATE(self)->journal;
+  journal->writing = false;
+  if (journal->reset_pending) {
+    journal->reset_pending = false;
+    reset_journal(self);
+  } else if (journal->flush_pending) {
+    journal->flush_pending = false;
+    flush_journal(self);
+  }
+}
+
+static void write_journal(AtomTextEditorWidget *self, JournalWrite *write) {
+  GET_PRIVATE(self)->journal->writing = true;
+  GTask *task = g_task_new(self, NULL, write_journal_ready, NULL);
+  g_task_set_task_data(task, write, [](gpointer write) {
+    delete (JournalWrite *)write;
+  });
+  g_task_run_in_thread(task, write_journal_thread);
+  g_object_unref(task);
+}
+
+// replaces the journal with a single record holding the whole text
+static gboolean compact_journal(gpointer user_data) {
+  AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(user_data);
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  JournalState *journal = priv->journal;
+  // a write in flight is appending to the journal, try again later
+  if (journal->writing) return G_SOURCE_CONTINUE;
+  journal->compact_id = 0;
+  if (!journal->path) return G_SOURCE_REMOVE;
+  if (journal->timeout_id) {
+    g_source_remove(journal->timeout_id);
+    journal->timeout_id = 0;
+  }
+  JournalWrite *write = new JournalWrite();
+  write->path = journal->path;
+  write->replace = true;
+  append_journal_header(write->data, journal->header);
+  append_journal_record(write->data, Range(Point(0, 0), journal->base_end), priv->text_editor->getBuffer()->getText());
+  // the pending records are part of the text
+  journal->records.clear();
+  journal->size = write->data.size();
+  write_journal(self, write);
+  return G_SOURCE_REMOVE;
+}
+
+static void flush_journal(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  JournalState *journal = priv->journal;
+  if (!journal->path || journal->records.empty()) return;
+  // batches are written one at a time and in order
+  if (journal->writing) {
+    journal->flush_pending = true;
+    return;
+  }
+  TextBuffer *buffer = priv->text_editor->getBuffer();
+  JournalWrite *write = new JournalWrite();
+  write->path = journal->path;
+  write->replace = journal->size == 0;
+  if (write->replace) {
+    append_journal_header(write->data, journal->header);
+    write->data.append(journal->records);
+  } else {
+    write->data = std::move(journal->records);
+  }
+  journal->records.clear();
+  journal->size = write->replace ? write->data.size() : journal->size + write->data.size();
+  write_journal(self, write);
+  // once the journal is larger than the text, the text itself is the shorter record. copying it
+  // waits until typing has paused
+  const size_t length = buffer->getLength();
+  if (journal->size > length * sizeof(char16_t) && length <= JOURNAL_COMPACT_MAX_LENGTH) {
+    if (journal->compact_id) g_source_remove(journal->compact_id);
+    journal->compact_id = g_timeout_add(JOURNAL_COMPACT_DELAY, compact_journal, self);
+  }
+}
+
+static void schedule_journal(AtomTextEditorWidget *self) {
+  JournalState *journal = GET_PRIVATE(self)->journal;
+  if (!journal->path || journal->timeout_id) return;
+  journal->timeout_id = g_timeout_add(JOURNAL_DELAY, [](gpointer user_data) -> gboolean {
+    AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(user_data);
+    GET_PRIVATE(self)->journal->timeout_id = 0;
+    flush_journal(self);
+    return G_SOURCE_REMOVE;
+  }, self);
+}
+
+// starts an empty journal on top of the file as it is on disk, called after loading and saving
+static void reset_journal(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  JournalState *journal = priv->journal;
+  if (journal->writing) {
+    journal->reset_pending = true;
+    return;
+  }
+  if (journal->timeout_id) {
+    g_source_remove(journal->timeout_id);
+    journal->timeout_id = 0;
+  }
+  if (journal->compact_id) {
+    g_source_remove(journal->compact_id);
+    journal->compact_id = 0;
+  }
+  if (journal->path) {
+    g_unlink(journal->path);
+    g_free(journal->path);
+    journal->path = NULL;
+  }
+  journal->records.clear();
+  journal->size = 0;
+  journal->flush_pending = false;
+  optional<std::string> path = priv->text_editor->getPath();
+  GStatBuf stat_buffer;
+  // untitled buffers cannot be replayed onto a file
+  if (!path || g_stat(path->c_str(), &stat_buffer) != 0) return;
+  TextBuffer *buffer = priv->text_editor->getBuffer();
+  journal->path = get_journal_path(path->c_str());
+  journal->header = {*path, get_modification_time(stat_buffer), stat_buffer.st_size, (uint64_t)buffer->getLength()};
+  const double last_row = buffer->getLastRow();
+  journal->base_end = Point(last_row, buffer->lineLengthForRow(last_row));
+}
+
+// reads and removes the journal a crash left behind for the file. it is only replayed onto the
+// exact text it was started from
+static std::vector<JournalRecord> read_journal(const gchar *path, TextBuffer *buffer) {
+  std::vector<JournalRecord> records;
+  gchar *journal_path = get_journal_path(path);
+  gchar *contents;
+  gsize length;
+  if (g_file_get_contents(journal_path, &contents, &length, NULL)) {
+    JournalHeader header;
+    if (!parse_journal(contents, length, header, records) || header.file_path != path || !journal_matches_file(header) || header.base_length != (uint64_t)buffer->getLength()) {
+      records.clear();
+    }
+    g_free(contents);
+    g_unlink(journal_path);
+  }
+  g_free(journal_path);
+  return records;
+}
+
+// the files that have a journal left behind by a crash, journals that no longer match their file are removed
+gchar **atom_text_editor_widget_get_recoverable_files() {
+  GPtrArray *files = g_ptr_array_new();
+  gchar *directory_path = get_journal_directory();
+  if (GDir *directory = g_dir_open(directory_path, 0, NULL)) {
+    while (const gchar *name = g_dir_read_name(directory)) {
+      gchar *journal_path = g_build_filename(directory_path, name, NULL);
+      gchar *contents;
+      gsize length;
+      if (g_file_get_contents(journal_path, &contents, &length, NULL)) {
+        JournalHeader header;
+        std::vector<JournalRecord> records;
+        if (parse_journal(contents, length, header, records) && !records.empty() && journal_matches_file(header)) {
+          g_ptr_array_add(files, g_strdup(header.file_path.c_str()));
+        } else {
+          g_unlink(journal_path);
+        }
+        g_free(contents);
+      }
+      g_free(journal_path);
+    }
+    g_dir_close(directory);
+  }
+  g_free(directory_path);
+  g_ptr_array_add(files, NULL);
+  return (gchar **)g_ptr_array_free(files, FALSE);
+}
+
+static void highlight_cache_ready(GObject *source_object, GAsyncResult *result, gpointer user_data) {
+  HighlightCache *cache = (HighlightCache *)g_task_propagate_pointer(G_TASK(result), NULL);
+  // a cancelled load returns nothing and the widget might already be gone
+  if (!cache) return;
+  AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(user_data);
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  g_object_unref(priv->highlight_cache_cancellable);
+  priv->highlight_cache_cancellable = NULL;
+  priv->highlight_cache = cache;
+  if (cache->loaded) {
+    priv->layout_cache->clear();
+    queue_update(self, PENDING_UPDATE_CONTENT);
+  }
+  // the initial parse of a large file blocks for a while, show it as plain text until the first frame is drawn
+  priv->language_mode_source_id = g_idle_add_full(G_PRIORITY_LOW, [](gpointer user_data) -> gboolean {
+    AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(user_data);
+    AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+    priv->language_mode_source_id = 0;
+    grammar_registry.maintainLanguageMode(priv->text_editor->getBuffer());
+    save_highlight_cache(self);
+    // drop the layouts that were colored from the cache, and the brackets found in strings and comments
+    priv->layout_cache->clear();
+    mark_bracket_rows(priv->brackets, 0, priv->text_editor->getBuffer()->getLastRow());
+    queue_update(self, PENDING_UPDATE_CONTENT | PENDING_UPDATE_BRACKETS);
+    return G_SOURCE_REMOVE;
+  }, self, NULL);
+}
+
 AtomTextEditorWidget *atom_text_editor_widget_new(GFile *file) {
   AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(g_object_new(ATOM_TYPE_TEXT_EDITOR_WIDGET, NULL));
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
   TextBuffer *buffer;
+  std::vector<JournalRecord> journal_records;
   if (file) {
     gchar *path = g_file_get_path(file);
     buffer = TextBuffer::loadSync(path);
+    journal_records = read_journal(path, buffer);
+    add_grammars_for_file(path, buffer);
     g_free(path);
   } else {
     buffer = new TextBuffer();
   }
-  grammar_registry.maintainLanguageMode(buffer);
+  priv->degraded = is_large_file(buffer);
+  priv->highlighting = !priv->degraded;
+  priv->bracket_matching = !priv->degraded;
+  priv->whitespace_handling = !priv->degraded;
+  priv->token_styling = !priv->degraded;
+  const bool defer_parse = priv->highlighting && buffer->getLength() >= DEFERRED_PARSE_LENGTH;
+  if (priv->highlighting && !defer_parse) {
+    grammar_registry.maintainLanguageMode(buffer);
+  }
   priv->text_editor = new TextEditor(buffer);
   if (optional<bool> uses_soft_tabs = priv->text_editor->usesSoftTabs()) {
     priv->text_editor->setSoftTabs(*uses_soft_tabs);
   }
   priv->match_manager = new MatchManager(priv->text_editor);
   priv->bracket_matcher = new BracketMatcher(priv->text_editor, priv->match_manager);
-  priv->bracket_matcher_view = new BracketMatcherView(priv->text_editor, priv->match_manager);
   priv->select_next = new SelectNext(priv->text_editor);
-  whitespace.handleEvents(priv->text_editor);
+  priv->find = new FindState();
+  priv->find->marker_layer = priv->text_editor->addMarkerLayer();
+  priv->find->cancellable = NULL;
+  priv->find->searching = false;
+  priv->find->timeout_id = 0;
+  priv->find->replace_all_pending = false;
+  priv->occurrences = new OccurrenceIndex();
+  priv->selecting_occurrences = false;
+  priv->git = new GitState();
+  priv->git->head_cancellable = NULL;
+  priv->git->diff_cancellable = NULL;
+  priv->git->timeout_id = 0;
+  const char *git_classes[GIT_LINE_STATUS_COUNT] = {"git-line-added", "git-line-modified", "git-line-removed"};
+  for (int status = 0; status < GIT_LINE_STATUS_COUNT; status++) {
+    priv->git->marker_layers[status] = priv->text_editor->addMarkerLayer();
+    Decoration::Properties git_properties;
+    git_properties.type = Decoration::Type::line_number;
+    git_properties.class_ = git_classes[status];
+    priv->text_editor->decorateMarkerLayer(priv->git->marker_layers[status], git_properties);
+  }
+  priv->journal = new JournalState();
+  priv->journal->path = NULL;
+  priv->journal->size = 0;
+  priv->journal->timeout_id = 0;
+  priv->journal->compact_id = 0;
+  priv->journal->writing = false;
+  priv->journal->flush_pending = false;
+  priv->journal->reset_pending = false;
+  reset_journal(self);
+  priv->brackets = new BracketState();
+  priv->brackets->marker_layer = priv->text_editor->addMarkerLayer();
+  priv->brackets->highlighted = false;
+  priv->brackets->edited = false;
+  priv->brackets->index.splice(0, 0, buffer->getLineCount());
+  mark_bracket_rows(priv->brackets, 0, buffer->getLastRow());
+  Decoration::Properties bracket_properties;
+  bracket_properties.type = Decoration::Type::highlight;
+  bracket_properties.class_ = "bracket-matcher";
+  priv->text_editor->decorateMarkerLayer(priv->brackets->marker_layer, bracket_properties);
+  Decoration::Properties find_result_properties;
+  find_result_properties.type = Decoration::Type::highlight;
+  find_result_properties.class_ = "find-result";
+  priv->text_editor->decorateMarkerLayer(priv->find->marker_layer, find_result_properties);
+  if (priv->whitespace_handling) {
+    whitespace.handleEvents(priv->text_editor);
+  }
   priv->text_editor->onDidChange([self]() {
-    update(self);
+    AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+    if (priv->find->search) {
+      // results of a running search no longer match the text, search again once the user stops typing
+      cancel_search(priv->find);
+      if (priv->find->timeout_id) {
+        g_source_remove(priv->find->timeout_id);
+      }
+      priv->find->timeout_id = g_timeout_add(FIND_DELAY, [](gpointer user_data) -> gboolean {
+        AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(user_data);
+        GET_PRIVATE(self)->find->timeout_id = 0;
+        restart_search(self);
+        return G_SOURCE_REMOVE;
+      }, self);
+    }
+    priv->primary_range_changed = true;
+    schedule_git_diff(self, GIT_DIFF_DELAY);
+    schedule_journal(self);
+    queue_update(self, PENDING_UPDATE_CONTENT | PENDING_UPDATE_BRACKETS);
   });
   priv->text_editor->onDidChangeSelectionRange([self]() {
-    const std::u16string selected_text = GET_PRIVATE(self)->text_editor->getSelectedText();
-    if (!selected_text.empty()) {
-      gchar *utf8 = g_utf16_to_utf8((const gunichar2 *)selected_text.c_str(), selected_text.size(), NULL, NULL, NULL);
-      GtkClipboard *clipboard = gtk_widget_get_clipboard(GTK_WIDGET(self), GDK_SELECTION_PRIMARY);
-      gtk_clipboard_set_text(clipboard, utf8, -1);
-      g_free(utf8);
+    update_primary_selection(self);
+    queue_update(self, PENDING_UPDATE_BRACKETS);
+  });
+  // the buffer reports every edit with its old and new range, the indexes that follow edits incrementally are fed from here
+  priv->text_editor->getBuffer()->onDidChange([self](const auto &event) {
+    const BufferChange change{event.oldRange, event.newRange};
+    AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+    // the occurrences are only searched again when select-next needs them
+    priv->occurrences->add_change(change);
+    if (priv->journal->path) {
+      append_journal_record(priv->journal->records, change.old_range, priv->text_editor->getBuffer()->getTextInRange(change.new_range));
+    }
+    BracketState *brackets = priv->brackets;
+    brackets->index.splice(change.old_range.start.row, change.old_range.end.row - change.old_range.start.row + 1, change.new_range.end.row - change.new_range.start.row + 1);
+    brackets->dirty_rows.add(change);
+    brackets->edited = true;
+    if (priv->git->diff_cancellable) {
+      priv->git->changes.push_back(change);
+    } else {
+      priv->git->diff.add_change(change);
     }
   });
   priv->text_editor->selectionsMarkerLayer->onDidUpdate([self]() {
-    g_object_notify(G_OBJECT(self), "cursor-position");
-    g_object_notify(G_OBJECT(self), "selection-count");
-    start_blinking(self);
+    AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+    if (!priv->selecting_occurrences) {
+      priv->occurrences->clear_selection();
+    }
+    queue_update(self, PENDING_UPDATE_SELECTIONS);
   });
   priv->text_editor->onDidRequestAutoscroll([self](const Range &range) {
-    autoscroll(self, range);
+    // scroll after the vertical adjustment has been updated for pending changes
+    GET_PRIVATE(self)->autoscroll_range = range;
+    queue_update(self, PENDING_UPDATE_AUTOSCROLL);
   });
   priv->text_editor->onDidChangeTitle([self]() {
     g_object_notify(G_OBJECT(self), "title");
@@ -379,10 +1437,30 @@ AtomTextEditorWidget *atom_text_editor_widget_new(GFile *file) {
     g_object_notify(G_OBJECT(self), "path");
   });
   priv->text_editor->onDidChangeGrammar([self]() {
+    // strings and comments are different in the new grammar
+    AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+    mark_bracket_rows(priv->brackets, 0, priv->text_editor->getBuffer()->getLastRow());
+    queue_update(self, PENDING_UPDATE_BRACKETS);
     g_object_notify(G_OBJECT(self), "grammar");
   });
+  priv->cursor_position = priv->text_editor->getCursorBufferPosition();
+  priv->selected_range = priv->text_editor->getSelectedBufferRange();
   const double padding = round(priv->char_width);
-  priv->gutter_width = padding * 4 + round(count_digits(priv->text_editor->getScreenLineCount()) * priv->char_width);
+  priv->gutter_width = padding * 4 + round(count_digits(priv->text_editor->getBuffer()->getLineCount()) * priv->char_width);
+  // the edits a crash left unsaved are replayed like typing, the tab shows them as modified and they go into the new journal
+  if (!journal_records.empty()) {
+    replay_journal(buffer, journal_records);
+    flush_journal(self);
+  }
+  load_git_head(self);
+  if (defer_parse) {
+    // the file is parsed once its cached highlighting has been looked up
+    priv->highlight_cache_cancellable = g_cancellable_new();
+    GTask *task = g_task_new(NULL, priv->highlight_cache_cancellable, highlight_cache_ready, self);
+    g_task_set_task_data(task, g_file_get_path(file), g_free);
+    g_task_run_in_thread(task, load_highlight_cache_thread);
+    g_object_unref(task);
+  }
   return self;
 }
 
@@ -398,6 +1476,7 @@ static void set_accels_for_signal(GtkBindingSet *binding_set, const gchar *signa
 }
 
 static void atom_text_editor_widget_class_init(AtomTextEditorWidgetClass *klass) {
+  G_OBJECT_CLASS(klass)->dispose = atom_text_editor_widget_dispose;
   G_OBJECT_CLASS(klass)->finalize = atom_text_editor_widget_finalize;
   G_OBJECT_CLASS(klass)->set_property = atom_text_editor_widget_set_property;
   G_OBJECT_CLASS(klass)->get_property = atom_text_editor_widget_get_property;
@@ -445,6 +1524,7 @@ static void atom_text_editor_widget_class_init(AtomTextEditorWidgetClass *klass)
   klass->add_selection_above = atom_text_editor_widget_add_selection_above;
   klass->add_selection_below = atom_text_editor_widget_add_selection_below;
   klass->select_next = atom_text_editor_widget_select_next;
+  klass->select_all_occurrences = atom_text_editor_widget_select_all_occurrences;
   klass->insert_newline = atom_text_editor_widget_insert_newline;
   klass->insert_newline_above = atom_text_editor_widget_insert_newline_above;
   klass->insert_newline_below = atom_text_editor_widget_insert_newline_below;
@@ -465,6 +1545,8 @@ static void atom_text_editor_widget_class_init(AtomTextEditorWidgetClass *klass)
   klass->copy = atom_text_editor_widget_copy;
   klass->cut = atom_text_editor_widget_cut;
   klass->paste = atom_text_editor_widget_paste;
+  klass->find_next = atom_text_editor_widget_find_next;
+  klass->find_previous = atom_text_editor_widget_find_previous;
   ADD_SIGNAL("move-up", move_up);
   ADD_SIGNAL("move-down", move_down);
   ADD_SIGNAL("move-left", move_left);
@@ -501,6 +1583,7 @@ static void atom_text_editor_widget_class_init(AtomTextEditorWidgetClass *klass)
   ADD_SIGNAL("add-selection-above", add_selection_above);
   ADD_SIGNAL("add-selection-below", add_selection_below);
   ADD_SIGNAL("select-next", select_next);
+  ADD_SIGNAL("select-all-occurrences", select_all_occurrences);
   ADD_SIGNAL("insert-newline", insert_newline);
   ADD_SIGNAL("insert-newline-above", insert_newline_above);
   ADD_SIGNAL("insert-newline-below", insert_newline_below);
@@ -521,6 +1604,8 @@ static void atom_text_editor_widget_class_init(AtomTextEditorWidgetClass *klass)
   ADD_SIGNAL("copy", copy);
   ADD_SIGNAL("cut", cut);
   ADD_SIGNAL("paste", paste);
+  ADD_SIGNAL("find-next", find_next);
+  ADD_SIGNAL("find-previous", find_previous);
   GtkBindingSet *binding_set = gtk_binding_set_by_class(klass);
   set_accels_for_signal(binding_set, "move-up", {"Up", "KP_Up"});
   set_accels_for_signal(binding_set, "move-down", {"Down", "KP_Down"});
@@ -573,11 +1658,14 @@ static void atom_text_editor_widget_class_init(AtomTextEditorWidgetClass *klass)
   set_accels_for_signal(binding_set, "add-selection-above", {"<Alt><Shift>Up", "<Alt><Shift>KP_Up"});
   set_accels_for_signal(binding_set, "add-selection-below", {"<Alt><Shift>Down", "<Alt><Shift>KP_Down"});
   set_accels_for_signal(binding_set, "select-next", {"<Primary>D"});
+  set_accels_for_signal(binding_set, "select-all-occurrences", {"<Alt>F3"});
   set_accels_for_signal(binding_set, "undo", {"<Primary>Z"});
   set_accels_for_signal(binding_set, "redo", {"<Primary>Y", "<Primary><Shift>Z"});
   set_accels_for_signal(binding_set, "copy", {"<Primary>C"});
   set_accels_for_signal(binding_set, "cut", {"<Primary>X"});
   set_accels_for_signal(binding_set, "paste", {"<Primary>V"});
+  set_accels_for_signal(binding_set, "find-next", {"F3"});
+  set_accels_for_signal(binding_set, "find-previous", {"<Shift>F3"});
   g_object_class_override_property(G_OBJECT_CLASS(klass), PROP_HADJUSTMENT, "hadjustment");
   g_object_class_override_property(G_OBJECT_CLASS(klass), PROP_VADJUSTMENT, "vadjustment");
   g_object_class_override_property(G_OBJECT_CLASS(klass), PROP_HSCROLL_POLICY, "hscroll-policy");
@@ -588,65 +1676,198 @@ static void atom_text_editor_widget_class_init(AtomTextEditorWidgetClass *klass)
   g_object_class_install_property(G_OBJECT_CLASS(klass), PROP_CURSOR_POSITION, g_param_spec_string("cursor-position", NULL, NULL, NULL, (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
   g_object_class_install_property(G_OBJECT_CLASS(klass), PROP_SELECTION_COUNT, g_param_spec_string("selection-count", NULL, NULL, NULL, (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
   g_object_class_install_property(G_OBJECT_CLASS(klass), PROP_GRAMMAR, g_param_spec_string("grammar", NULL, NULL, NULL, (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(G_OBJECT_CLASS(klass), PROP_PROGRESS, g_param_spec_double("progress", NULL, NULL, 0.0, 1.0, 0.0, (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(G_OBJECT_CLASS(klass), PROP_MATCH_COUNT, g_param_spec_int("match-count", NULL, NULL, 0, G_MAXINT, 0, (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(G_OBJECT_CLASS(klass), PROP_DEGRADED, g_param_spec_boolean("degraded", NULL, NULL, FALSE, (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(G_OBJECT_CLASS(klass), PROP_HIGHLIGHTING, g_param_spec_boolean("highlighting", NULL, NULL, TRUE, (GParamFlags)(G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(G_OBJECT_CLASS(klass), PROP_BRACKET_MATCHING, g_param_spec_boolean("bracket-matching", NULL, NULL, TRUE, (GParamFlags)(G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(G_OBJECT_CLASS(klass), PROP_WHITESPACE_HANDLING, g_param_spec_boolean("whitespace-handling", NULL, NULL, TRUE, (GParamFlags)(G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(G_OBJECT_CLASS(klass), PROP_TOKEN_STYLING, g_param_spec_boolean("token-styling", NULL, NULL, TRUE, (GParamFlags)(G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(G_OBJECT_CLASS(klass), PROP_SOFT_WRAPPED, g_param_spec_boolean("soft-wrapped", NULL, NULL, FALSE, (GParamFlags)(G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS)));
   gtk_widget_class_set_css_name(GTK_WIDGET_CLASS(klass), "atom-text-editor");
-  grammar_registry.addGrammar(atom_language_c());
-  grammar_registry.addGrammar(atom_language_cpp());
-  grammar_registry.addGrammar(atom_language_css());
-  grammar_registry.addGrammar(atom_language_go());
-  grammar_registry.addGrammar(atom_language_html());
-  grammar_registry.addGrammar(atom_language_javascript());
-  grammar_registry.addGrammar(atom_language_json());
-  grammar_registry.addGrammar(atom_language_python());
-  grammar_registry.addGrammar(atom_language_rust());
 }
 
-static void atom_text_editor_widget_init(AtomTextEditorWidget *self) {
-  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
-  priv->hadjustment = NULL;
-  priv->vadjustment = NULL;
-  priv->im_context = gtk_im_multicontext_new();
-  g_signal_connect_object(priv->im_context, "commit", G_CALLBACK(atom_text_editor_widget_handle_commit), self, G_CONNECT_DEFAULT);
-  priv->multipress_gesture = gtk_gesture_multi_press_new(GTK_WIDGET(self));
-  gtk_gesture_single_set_button(GTK_GESTURE_SINGLE(priv->multipress_gesture), 0);
-  g_signal_connect_object(priv->multipress_gesture, "pressed", G_CALLBACK(atom_text_editor_widget_handle_pressed), self, G_CONNECT_DEFAULT);
-  g_signal_connect_object(priv->multipress_gesture, "released", G_CALLBACK(atom_text_editor_widget_handle_released), self, G_CONNECT_DEFAULT);
-  priv->drag_gesture = gtk_gesture_drag_new(GTK_WIDGET(self));
-  g_signal_connect_object(priv->drag_gesture, "drag-update", G_CALLBACK(atom_text_editor_widget_handle_drag_update), self, G_CONNECT_DEFAULT);
-  GSettings *settings = g_settings_new("org.gnome.desktop.interface");
-  gchar *monospace_font_name = g_settings_get_string(settings, "monospace-font-name");
-  g_object_unref(settings);
-  priv->font_description = pango_font_description_from_string(monospace_font_name);
-  g_free(monospace_font_name);
-  PangoFontMetrics *metrics = pango_context_get_metrics(gtk_widget_get_pango_context(GTK_WIDGET(self)), priv->font_description, NULL);
-  double font_size = pango_units_to_double(pango_font_description_get_size(priv->font_description));
-  if (!pango_font_description_get_size_is_absolute(priv->font_description)) {
-    font_size = font_size / 72.0 * 96.0;
-  }
-  const double ascent = pango_units_to_double(pango_font_metrics_get_ascent(metrics));
-  const double descent = pango_units_to_double(pango_font_metrics_get_descent(metrics));
-  priv->line_height = round(font_size * LINE_HEIGHT_FACTOR);
-  priv->ascent = round(ascent + (priv->line_height - (ascent + descent)) / 2.0);
-  priv->char_width = pango_units_to_double(pango_font_metrics_get_approximate_char_width(metrics));
-  pango_font_metrics_unref(metrics);
+// the monospace font is the same in every editor, so it is loaded and measured once
+// and again only when the desktop setting changes
+struct FontService {
+  GSettings *settings;
+  PangoFontDescription *font_description;
+  double ascent;
+  double line_height;
+  double char_width;
+};
+
+static void load_font(FontService *font) {
+  gchar *monospace_font_name = g_settings_get_string(font->settings, "monospace-font-name");
+  if (font->font_description) {
+    pango_font_description_free(font->font_description);
+  }
+  font->font_description = pango_font_description_from_string(monospace_font_name);
+  g_free(monospace_font_name);
+  PangoContext *context = gdk_pango_context_get();
+  PangoFontMetrics *metrics = pango_context_get_metrics(context, font->font_description, NULL);
+  double font_size = pango_units_to_double(pango_font_description_get_size(font->font_description));
+  if (!pango_font_description_get_size_is_absolute(font->font_description)) {
+    font_size = font_size / 72.0 * 96.0;
+  }
+  const double ascent = pango_units_to_double(pango_font_metrics_get_ascent(metrics));
+  const double descent = pango_units_to_double(pango_font_metrics_get_descent(metrics));
+  font->line_height = round(font_size * LINE_HEIGHT_FACTOR);
+  font->ascent = round(ascent + (font->line_height - (ascent + descent)) / 2.0);
+  font->char_width = pango_units_to_double(pango_font_metrics_get_approximate_char_width(metrics));
+  pango_font_metrics_unref(metrics);
+  g_object_unref(context);
+}
+
+static void handle_font_service_changed(GSettings *settings, gchar *key, gpointer user_data) {
+  load_font((FontService *)user_data);
+}
+
+static FontService *get_font_service() {
+  static FontService *font = NULL;
+  if (!font) {
+    font = new FontService();
+    font->settings = g_settings_new("org.gnome.desktop.interface");
+    font->font_description = NULL;
+    load_font(font);
+    // connected before any editor, so the editors are notified after the font has been measured again
+    g_signal_connect(font->settings, "changed::monospace-font-name", G_CALLBACK(handle_font_service_changed), font);
+  }
+  return font;
+}
+
+static void apply_font(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  FontService *font = get_font_service();
+  priv->font_description = font->font_description;
+  priv->ascent = font->ascent;
+  priv->line_height = font->line_height;
+  priv->char_width = font->char_width;
+}
+
+static void handle_font_changed(GSettings *settings, gchar *key, gpointer user_data) {
+  AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(user_data);
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  apply_font(self);
+  priv->layout_cache->clear();
+  if (gtk_widget_get_realized(GTK_WIDGET(self))) {
+    apply_soft_wrap(self);
+    update(self);
+  }
+}
+
+static void atom_text_editor_widget_init(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  priv->hadjustment = NULL;
+  priv->vadjustment = NULL;
+  priv->im_context = gtk_im_multicontext_new();
+  g_signal_connect_object(priv->im_context, "commit", G_CALLBACK(atom_text_editor_widget_handle_commit), self, G_CONNECT_DEFAULT);
+  priv->multipress_gesture = gtk_gesture_multi_press_new(GTK_WIDGET(self));
+  gtk_gesture_single_set_button(GTK_GESTURE_SINGLE(priv->multipress_gesture), 0);
+  g_signal_connect_object(priv->multipress_gesture, "pressed", G_CALLBACK(atom_text_editor_widget_handle_pressed), self, G_CONNECT_DEFAULT);
+  g_signal_connect_object(priv->multipress_gesture, "released", G_CALLBACK(atom_text_editor_widget_handle_released), self, G_CONNECT_DEFAULT);
+  priv->drag_gesture = gtk_gesture_drag_new(GTK_WIDGET(self));
+  g_signal_connect_object(priv->drag_gesture, "drag-update", G_CALLBACK(atom_text_editor_widget_handle_drag_update), self, G_CONNECT_DEFAULT);
+  apply_font(self);
+  g_signal_connect_object(get_font_service()->settings, "changed::monospace-font-name", G_CALLBACK(handle_font_changed), self, G_CONNECT_DEFAULT);
   priv->draw_cursors = false;
   priv->blink_source_id = 0;
-  priv->layout_cache = new LayoutCache<AtomTextEditorWidget, Layout>();
+  priv->pending_updates = 0;
+  priv->tick_callback_id = 0;
+  priv->autoscroll_pending = false;
+  priv->pending_scroll_row = -1;
+  priv->scroll_width = 0;
+  priv->soft_wrapped = false;
+  priv->wrap_width_in_chars = 0;
+  priv->screen_line_count = 0;
+  priv->primary_range_changed = false;
+  priv->primary_text = nullptr;
+  priv->paste_job = nullptr;
+  priv->layout_cache = new LayoutCache<AtomTextEditorWidget, Layout, LayoutSegment>();
+  priv->prewarmed_start_row = -1;
+  priv->prewarmed_end_row = -1;
   priv->style_cache = new StyleCache();
+  priv->frame = new FrameScratch();
   gtk_widget_set_can_focus(GTK_WIDGET(self), TRUE);
   gtk_widget_add_events(GTK_WIDGET(self), GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK);
 }
 
+static void atom_text_editor_widget_dispose(GObject *object) {
+  // the rest of a running paste is dropped together with the tab
+  cancel_paste(ATOM_TEXT_EDITOR_WIDGET(object));
+  G_OBJECT_CLASS(atom_text_editor_widget_parent_class)->dispose(object);
+}
+
 static void atom_text_editor_widget_finalize(GObject *object) {
   AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(object);
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
   g_object_unref(priv->drag_gesture);
   g_object_unref(priv->multipress_gesture);
   g_object_unref(priv->im_context);
+  if (priv->find->cancellable) {
+    g_cancellable_cancel(priv->find->cancellable);
+    g_object_unref(priv->find->cancellable);
+  }
+  if (priv->find->timeout_id) {
+    g_source_remove(priv->find->timeout_id);
+  }
+  delete priv->find;
+  delete priv->occurrences;
+  // the tab was closed on purpose, its journal is no longer needed
+  if (priv->journal->timeout_id) {
+    g_source_remove(priv->journal->timeout_id);
+  }
+  if (priv->journal->compact_id) {
+    g_source_remove(priv->journal->compact_id);
+  }
+  if (priv->journal->path) {
+    g_unlink(priv->journal->path);
+    g_free(priv->journal->path);
+  }
+  delete priv->journal;
+  delete priv->brackets;
+  if (priv->git->head_cancellable) {
+    g_cancellable_cancel(priv->git->head_cancellable);
+    g_object_unref(priv->git->head_cancellable);
+  }
+  if (priv->git->diff_cancellable) {
+    g_cancellable_cancel(priv->git->diff_cancellable);
+    g_object_unref(priv->git->diff_cancellable);
+  }
+  if (priv->git->timeout_id) {
+    g_source_remove(priv->git->timeout_id);
+  }
+  delete priv->git;
+  if (priv->language_mode_source_id) {
+    g_source_remove(priv->language_mode_source_id);
+  }
+  if (priv->highlight_cache_cancellable) {
+    g_cancellable_cancel(priv->highlight_cache_cancellable);
+    g_object_unref(priv->highlight_cache_cancellable);
+  }
+  if (priv->highlight_cache) {
+    free_highlight_cache(priv->highlight_cache);
+  }
+  if (priv->prewarm_source_id) {
+    g_source_remove(priv->prewarm_source_id);
+  }
+  GtkClipboard *clipboard = gtk_widget_get_clipboard(GTK_WIDGET(self), GDK_SELECTION_PRIMARY);
+  if (gtk_clipboard_get_owner(clipboard) == object) {
+    gtk_clipboard_clear(clipboard);
+  }
+  clipboard = gtk_widget_get_clipboard(GTK_WIDGET(self), GDK_SELECTION_CLIPBOARD);
+  if (gtk_clipboard_get_owner(clipboard) == object) {
+    // the copied text has to outlive the widget
+    const std::u16string &text = priv->text_editor->clipboard.systemText;
+    gchar *utf8 = utf16_to_utf8_chunked(text);
+    gtk_clipboard_set_text(clipboard, utf8, -1);
+    g_free(utf8);
+  }
+  delete priv->primary_text;
   delete priv->style_cache;
+  delete priv->frame;
   delete priv->layout_cache;
-  pango_font_description_free(priv->font_description);
   delete priv->select_next;
-  delete priv->bracket_matcher_view;
   delete priv->bracket_matcher;
   delete priv->match_manager;
   delete priv->text_editor;
@@ -658,7 +1879,13 @@ static void atom_text_editor_widget_set_property(GObject *object, guint property
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
   switch (property_id) {
     case PROP_HADJUSTMENT:
-      priv->hadjustment = GTK_ADJUSTMENT(g_value_get_object(value));
+      {
+        GtkAdjustment *hadjustment = GTK_ADJUSTMENT(g_value_get_object(value));
+        if (hadjustment != priv->hadjustment) {
+          priv->hadjustment = hadjustment;
+          update(self, false);
+        }
+      }
       break;
     case PROP_VADJUSTMENT:
       {
@@ -675,6 +1902,21 @@ static void atom_text_editor_widget_set_property(GObject *object, guint property
     case PROP_VSCROLL_POLICY:
       priv->vscroll_policy = (GtkScrollablePolicy)g_value_get_enum(value);
       break;
+    case PROP_HIGHLIGHTING:
+      atom_text_editor_widget_set_highlighting(self, g_value_get_boolean(value));
+      break;
+    case PROP_BRACKET_MATCHING:
+      atom_text_editor_widget_set_bracket_matching(self, g_value_get_boolean(value));
+      break;
+    case PROP_WHITESPACE_HANDLING:
+      atom_text_editor_widget_set_whitespace_handling(self, g_value_get_boolean(value));
+      break;
+    case PROP_TOKEN_STYLING:
+      atom_text_editor_widget_set_token_styling(self, g_value_get_boolean(value));
+      break;
+    case PROP_SOFT_WRAPPED:
+      atom_text_editor_widget_set_soft_wrapped(self, g_value_get_boolean(value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
       break;
@@ -715,6 +1957,30 @@ static void atom_text_editor_widget_get_property(GObject *object, guint property
     case PROP_GRAMMAR:
       g_value_set_static_string(value, atom_text_editor_widget_get_grammar(self));
       break;
+    case PROP_PROGRESS:
+      g_value_set_double(value, atom_text_editor_widget_get_progress(self));
+      break;
+    case PROP_MATCH_COUNT:
+      g_value_set_int(value, atom_text_editor_widget_get_match_count(self));
+      break;
+    case PROP_DEGRADED:
+      g_value_set_boolean(value, priv->degraded);
+      break;
+    case PROP_HIGHLIGHTING:
+      g_value_set_boolean(value, priv->highlighting);
+      break;
+    case PROP_BRACKET_MATCHING:
+      g_value_set_boolean(value, priv->bracket_matching);
+      break;
+    case PROP_WHITESPACE_HANDLING:
+      g_value_set_boolean(value, priv->whitespace_handling);
+      break;
+    case PROP_TOKEN_STYLING:
+      g_value_set_boolean(value, priv->token_styling);
+      break;
+    case PROP_SOFT_WRAPPED:
+      g_value_set_boolean(value, priv->soft_wrapped);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
       break;
@@ -766,7 +2032,12 @@ static void atom_text_editor_widget_size_allocate(GtkWidget *widget, GtkAllocati
     gdk_window_move_resize(gtk_widget_get_window(widget), allocation->x, allocation->y, allocation->width, allocation->height);
     gdk_window_move_resize(priv->text_window, allocation->x + priv->gutter_width, allocation->y, allocation->width - priv->gutter_width, allocation->height);
   }
+  apply_soft_wrap(self);
   update(self, false);
+  if (priv->autoscroll_pending && gtk_adjustment_get_page_size(priv->vadjustment) > 0) {
+    priv->autoscroll_pending = false;
+    autoscroll(self, priv->autoscroll_range);
+  }
 }
 
 static gboolean atom_text_editor_widget_focus_in_event(GtkWidget *widget, GdkEventFocus *event) {
@@ -809,6 +2080,14 @@ gchar *atom_text_editor_widget_get_path(AtomTextEditorWidget *self) {
   return g_strdup(path.c_str());
 }
 
+GFile *atom_text_editor_widget_get_file(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  if (optional<std::string> path = priv->text_editor->getPath()) {
+    return g_file_new_for_path(path->c_str());
+  }
+  return NULL;
+}
+
 gchar *atom_text_editor_widget_get_cursor_position(AtomTextEditorWidget *self) {
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
   Point position = priv->text_editor->getCursorBufferPosition();
@@ -817,10 +2096,58 @@ gchar *atom_text_editor_widget_get_cursor_position(AtomTextEditorWidget *self) {
   return g_strdup_printf("%g:%g", row, column);
 }
 
+void atom_text_editor_widget_set_cursor_buffer_position(AtomTextEditorWidget *self, gdouble row, gdouble column) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  priv->text_editor->setCursorBufferPosition(Point(row, column));
+}
+
+// the selections as a flat array of start row, start column, end row and end column
+gdouble *atom_text_editor_widget_get_selected_ranges(AtomTextEditorWidget *self, gint *length) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  const std::vector<Range> ranges = priv->text_editor->getSelectedBufferRanges();
+  gdouble *result = g_new(gdouble, ranges.size() * 4);
+  for (size_t i = 0; i < ranges.size(); i++) {
+    result[i * 4 + 0] = ranges[i].start.row;
+    result[i * 4 + 1] = ranges[i].start.column;
+    result[i * 4 + 2] = ranges[i].end.row;
+    result[i * 4 + 3] = ranges[i].end.column;
+  }
+  *length = ranges.size() * 4;
+  return result;
+}
+
+void atom_text_editor_widget_set_selected_ranges(AtomTextEditorWidget *self, const gdouble *ranges, gint length) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  std::vector<Range> buffer_ranges;
+  for (gint i = 0; i + 3 < length; i += 4) {
+    buffer_ranges.push_back(Range(Point(ranges[i], ranges[i + 1]), Point(ranges[i + 2], ranges[i + 3])));
+  }
+  if (buffer_ranges.empty()) return;
+  priv->text_editor->setSelectedBufferRanges(buffer_ranges);
+}
+
+// the first visible screen row, possibly fractional
+gdouble atom_text_editor_widget_get_scroll_row(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  if (!priv->vadjustment) return 0;
+  return gtk_adjustment_get_value(priv->vadjustment) / priv->line_height;
+}
+
+// takes effect once the widget has been allocated and replaces any pending autoscroll
+void atom_text_editor_widget_set_scroll_row(AtomTextEditorWidget *self, gdouble row) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  priv->pending_scroll_row = fmax(row, 0.0);
+  priv->pending_updates &= ~PENDING_UPDATE_AUTOSCROLL;
+  priv->autoscroll_pending = false;
+  queue_update(self, PENDING_UPDATE_CONTENT);
+}
+
 gchar *atom_text_editor_widget_get_selection_count(AtomTextEditorWidget *self) {
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
-  double count = priv->text_editor->getSelectedText().size();
   Range range = priv->text_editor->getSelectedBufferRange();
+  // count the characters through the buffer index instead of copying the selected text
+  TextBuffer *buffer = priv->text_editor->getBuffer();
+  double count = buffer->characterIndexForPosition(range.end) - buffer->characterIndexForPosition(range.start);
   double lineCount = range.getRowCount();
   if (range.end.column == 0) {
     lineCount -= 1;
@@ -842,20 +2169,99 @@ const gchar *atom_text_editor_widget_get_grammar(AtomTextEditorWidget *self) {
   }
 }
 
+// prepares the state shared by all editors ahead of the first one, for a background start
+void atom_text_editor_widget_warm_up() {
+  g_type_class_ref(ATOM_TYPE_TEXT_EDITOR_WIDGET);
+  get_font_service();
+  for (size_t i = 0; i < lazy_grammar_count; i++) {
+    LazyGrammar &lazy_grammar = lazy_grammars[i];
+    if (!lazy_grammar.added) {
+      grammar_registry.addGrammar(lazy_grammar.create());
+      lazy_grammar.added = true;
+    }
+  }
+}
+
+gboolean atom_text_editor_widget_get_degraded(AtomTextEditorWidget *self) {
+  return GET_PRIVATE(self)->degraded;
+}
+
+// the language mode cannot be detached from the buffer again, so highlighting can only be turned on
+void atom_text_editor_widget_set_highlighting(AtomTextEditorWidget *self, gboolean highlighting) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  if (!highlighting || priv->highlighting) return;
+  priv->highlighting = true;
+  grammar_registry.maintainLanguageMode(priv->text_editor->getBuffer());
+  mark_bracket_rows(priv->brackets, 0, priv->text_editor->getBuffer()->getLastRow());
+  queue_update(self, PENDING_UPDATE_CONTENT | PENDING_UPDATE_BRACKETS);
+  g_object_notify(G_OBJECT(self), "highlighting");
+}
+
+void atom_text_editor_widget_set_bracket_matching(AtomTextEditorWidget *self, gboolean bracket_matching) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  if (bracket_matching == priv->bracket_matching) return;
+  priv->bracket_matching = bracket_matching;
+  queue_update(self, PENDING_UPDATE_BRACKETS);
+  g_object_notify(G_OBJECT(self), "bracket-matching");
+}
+
+// like the language mode, the whitespace handlers stay subscribed once they are turned on
+void atom_text_editor_widget_set_whitespace_handling(AtomTextEditorWidget *self, gboolean whitespace_handling) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  if (!whitespace_handling || priv->whitespace_handling) return;
+  priv->whitespace_handling = true;
+  whitespace.handleEvents(priv->text_editor);
+  g_object_notify(G_OBJECT(self), "whitespace-handling");
+}
+
+void atom_text_editor_widget_set_token_styling(AtomTextEditorWidget *self, gboolean token_styling) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  if (token_styling == priv->token_styling) return;
+  priv->token_styling = token_styling;
+  // the cached layouts were created with the previous setting
+  priv->layout_cache->clear();
+  gtk_widget_queue_draw(GTK_WIDGET(self));
+  g_object_notify(G_OBJECT(self), "token-styling");
+}
+
+void atom_text_editor_widget_set_soft_wrapped(AtomTextEditorWidget *self, gboolean soft_wrapped) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  if (soft_wrapped == priv->soft_wrapped) return;
+  priv->soft_wrapped = soft_wrapped;
+  if (gtk_widget_get_realized(GTK_WIDGET(self))) {
+    apply_soft_wrap(self);
+  }
+  g_object_notify(G_OBJECT(self), "soft-wrapped");
+}
+
 gboolean atom_text_editor_widget_save(AtomTextEditorWidget *self) {
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
   if (!priv->text_editor->getPath()) {
     return FALSE;
   }
+  // the saved file includes all of a running paste
+  if (priv->paste_job) {
+    finish_paste(self);
+  }
   priv->text_editor->save();
+  reset_journal(self);
+  // the file might have been committed since it was opened
+  load_git_head(self);
   return TRUE;
 }
 
 void atom_text_editor_widget_save_as(AtomTextEditorWidget *self, GFile *file) {
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  if (priv->paste_job) {
+    finish_paste(self);
+  }
   gchar *path = g_file_get_path(file);
+  // the new file name might call for a grammar that has not been needed yet
+  add_grammars_for_file(path, priv->text_editor->getBuffer());
   priv->text_editor->saveAs(path);
   g_free(path);
+  reset_journal(self);
+  load_git_head(self);
 }
 
 static void get_style_property_for_path(GtkWidget *widget, const std::vector<std::string> &path, const gchar *property, GValue *value) {
@@ -919,45 +2325,87 @@ static void emit_attributes(StyleCache *style_cache, GtkWidget *widget, gchar *u
   last_index = index;
 }
 
-static PangoLayout *create_layout(AtomTextEditorWidget *self, const DisplayLayer::ScreenLine &screen_line) {
+// the tags that color the screen line, until a large file has been parsed they come from the highlight cache
+static const std::vector<int32_t> *get_line_tags(AtomTextEditorWidget *self, const DisplayLayer::ScreenLine &screen_line, bool &cached) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  cached = false;
+  if (!priv->token_styling) return NULL;
+  HighlightCache *cache = priv->highlight_cache;
+  if (cache && priv->language_mode_source_id) {
+    auto iterator = cache->lines.find(screen_line.lineText);
+    if (iterator != cache->lines.end()) {
+      cached = true;
+      return &iterator->second;
+    }
+  }
+  return &screen_line.tags;
+}
+
+// the highlight cache opens a class with -2 * index - 1 and closes it with an even negative tag
+static bool is_open_tag(AtomTextEditorWidget *self, int32_t tag, bool cached) {
+  return cached ? tag < 0 && tag % 2 != 0 : GET_PRIVATE(self)->text_editor->displayLayer->isOpenTag(tag);
+}
+
+static bool is_close_tag(AtomTextEditorWidget *self, int32_t tag, bool cached) {
+  return cached ? tag < 0 && tag % 2 == 0 : GET_PRIVATE(self)->text_editor->displayLayer->isCloseTag(tag);
+}
+
+// lays out the text, colored by the tags if there are any
+static PangoLayout *create_layout(AtomTextEditorWidget *self, const std::u16string &text, const std::vector<int32_t> *tags, bool cached) {
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
   PangoLayout *layout = pango_layout_new(gtk_widget_get_pango_context(GTK_WIDGET(self)));
   pango_layout_set_font_description(layout, priv->font_description);
   DisplayLayer *display_layer = priv->text_editor->displayLayer;
-  const std::u16string &text = screen_line.lineText;
-  gchar *utf8 = g_utf16_to_utf8((const gunichar2 *)text.c_str(), text.size(), NULL, NULL, NULL);
+  const int32_t length = text.size();
+  gchar *utf8 = g_utf16_to_utf8((const gunichar2 *)text.c_str(), length, NULL, NULL, NULL);
   pango_layout_set_text(layout, utf8, -1);
-  PangoAttrList *attrs = pango_attr_list_new();
-  int32_t index = 0;
-  int32_t last_index = 0;
-  std::vector<std::string> classes = {"line"};
-  for (int32_t tag : screen_line.tags) {
-    if (display_layer->isOpenTag(tag)) {
-      emit_attributes(priv->style_cache, GTK_WIDGET(self), utf8, attrs, index, last_index, classes);
-      classes.push_back(display_layer->classNameForTag(tag));
-    } else if (display_layer->isCloseTag(tag)) {
-      emit_attributes(priv->style_cache, GTK_WIDGET(self), utf8, attrs, index, last_index, classes);
-      classes.pop_back();
-    } else {
-      index += tag;
+  if (tags) {
+    PangoAttrList *attrs = pango_attr_list_new();
+    int32_t index = 0;
+    int32_t last_index = 0;
+    std::vector<std::string> classes = {"line"};
+    auto emit = [&]() {
+      emit_attributes(priv->style_cache, GTK_WIDGET(self), utf8, attrs, std::min(index, length), last_index, classes);
+    };
+    for (int32_t tag : *tags) {
+      if (is_open_tag(self, tag, cached)) {
+        emit();
+        classes.push_back(cached ? priv->highlight_cache->classes[(-tag - 1) / 2] : display_layer->classNameForTag(tag));
+      } else if (is_close_tag(self, tag, cached)) {
+        emit();
+        classes.pop_back();
+      } else {
+        index += tag;
+        if (index >= length) {
+          emit();
+          break;
+        }
+      }
     }
+    pango_layout_set_attributes(layout, attrs);
+    pango_attr_list_unref(attrs);
   }
-  pango_layout_set_attributes(layout, attrs);
-  pango_attr_list_unref(attrs);
   g_free(utf8);
   return layout;
 }
 
-static PangoLayout *create_layout(AtomTextEditorWidget *self, double row) {
+static std::shared_ptr<LayoutSegment> get_layout_segment(AtomTextEditorWidget *self, std::u16string &&text, std::vector<int32_t> &&tags, bool cached) {
+  return GET_PRIVATE(self)->layout_cache->get_segment(self, std::move(text), std::move(tags), cached);
+}
+
+static double get_char_width(AtomTextEditorWidget *self) {
+  return GET_PRIVATE(self)->char_width;
+}
+
+static PangoLayout *create_layout(AtomTextEditorWidget *self, int glyph) {
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
   PangoLayout *layout = pango_layout_new(gtk_widget_get_pango_context(GTK_WIDGET(self)));
   pango_layout_set_font_description(layout, priv->font_description);
-  if (row == 0) {
+  if (glyph == 10) {
     pango_layout_set_text(layout, u8"\u2022", -1);
   } else {
-    gchar *text = g_strdup_printf("%d", (gint)row);
-    pango_layout_set_text(layout, text, -1);
-    g_free(text);
+    const char digit = '0' + glyph;
+    pango_layout_set_text(layout, &digit, 1);
   }
   return layout;
 }
@@ -1053,6 +2501,13 @@ static void parse_decoration(
   }
 }
 
+// fills a path element in place, which does not allocate once the string has grown large enough
+static const std::vector<std::string> &set_path_element(std::vector<std::string> &path, size_t index, const char *prefix, const std::string &classes) {
+  path[index].assign(prefix);
+  path[index].append(classes);
+  return path;
+}
+
 static void draw_gutter(
   GtkWidget *widget,
   cairo_t *cr,
@@ -1064,35 +2519,72 @@ static void draw_gutter(
 ) {
   AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(widget);
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
-  cairo_push_group(cr);
+  std::vector<std::string> &path = priv->frame->gutter_path;
+  // one pass over the rows, a row that continues the previous buffer row gets 0 and is drawn as a bullet
+  std::vector<double> &line_numbers = priv->frame->line_numbers;
+  line_numbers.clear();
+  double previous_buffer_row = start_row > 0 ? priv->text_editor->bufferRowForScreenRow(start_row - 1) : -1;
+  for (double row = start_row; row < end_row; row++) {
+    const double buffer_row = priv->text_editor->bufferRowForScreenRow(row);
+    line_numbers.push_back(buffer_row == previous_buffer_row ? 0 : buffer_row + 1);
+    previous_buffer_row = buffer_row;
+  }
+  // the gutter alpha is folded into the colors instead of compositing an offscreen group
   for (double row = start_row; row < end_row; row++) {
     double y = row * priv->line_height;
+    set_path_element(path, 1, "line-number ", gutter_classes[row - start_row]);
     if (!gutter_classes[row - start_row].empty()) {
       GdkRGBA background_color;
-      priv->style_cache->get_property(widget, {"gutter", "line-number " + gutter_classes[row - start_row]}, "background-color", &background_color);
+      priv->style_cache->get_property(widget, path, "background-color", &background_color);
+      background_color.alpha *= GUTTER_ALPHA;
       gdk_cairo_set_source_rgba(cr, &background_color);
       cairo_rectangle(cr, 0, y, allocated_width, priv->line_height);
       cairo_fill(cr);
     }
-    double buffer_row = priv->text_editor->bufferRowForScreenRow(row);
-    if (row > 0 && buffer_row == priv->text_editor->bufferRowForScreenRow(row - 1)) {
-      buffer_row = 0;
-    } else {
-      buffer_row = buffer_row + 1;
-    }
-    Layout layout = priv->layout_cache->get_line_number(self, buffer_row);
     GdkRGBA text_color;
-    priv->style_cache->get_property(widget, {"gutter", "line-number " + gutter_classes[row - start_row]}, "color", &text_color);
+    priv->style_cache->get_property(widget, path, "color", &text_color);
+    text_color.alpha *= GUTTER_ALPHA;
     gdk_cairo_set_source_rgba(cr, &text_color);
-    layout.draw(cr, allocated_width - padding * 2, y + priv->ascent, true);
+    double x = allocated_width - padding * 2;
+    int line_number = line_numbers[row - start_row];
+    if (line_number == 0) {
+      priv->layout_cache->get_glyph(self, 10).draw(cr, x, y + priv->ascent, true);
+      continue;
+    }
+    // digits from right to left
+    for (; line_number > 0; line_number /= 10) {
+      const Layout &digit = priv->layout_cache->get_glyph(self, line_number % 10);
+      x -= digit.get_width();
+      digit.draw(cr, x, y + priv->ascent);
+    }
+  }
+  for (double row = start_row; row < end_row; row++) {
+    const std::string &classes = gutter_classes[row - start_row];
+    if (classes.find("git-line-") == std::string::npos) continue;
+    double y = row * priv->line_height;
+    gint border_width;
+    GdkRGBA border_color;
+    set_path_element(path, 1, "line-number ", classes);
+    priv->style_cache->get_property(widget, path, "border-left-width", &border_width);
+    if (border_width > 0) {
+      priv->style_cache->get_property(widget, path, "border-left-color", &border_color);
+      gdk_cairo_set_source_rgba(cr, &border_color);
+      cairo_rectangle(cr, 0, y, border_width, priv->line_height);
+      cairo_fill(cr);
+    }
+    priv->style_cache->get_property(widget, path, "border-top-width", &border_width);
+    if (border_width > 0) {
+      priv->style_cache->get_property(widget, path, "border-top-color", &border_color);
+      gdk_cairo_set_source_rgba(cr, &border_color);
+      cairo_rectangle(cr, 0, y, allocated_width, border_width);
+      cairo_fill(cr);
+    }
   }
-  cairo_pop_group_to_source(cr);
-  cairo_paint_with_alpha(cr, 0.6);
 }
 
 template <class F> static void iterate_highlight_rectangles(
   AtomTextEditorWidgetPrivate *priv,
-  double allocated_width,
+  double visible_end,
   double start_row,
   double end_row,
   const std::vector<Layout> &layouts,
@@ -1107,7 +2599,7 @@ template <class F> static void iterate_highlight_rectangles(
     double x_end = layouts[range.start.row - start_row].index_to_x(range.end.column);
     f(x_start, y_start, x_end - x_start, y_end - y_start);
   } else {
-    double x_end = allocated_width;
+    double x_end = visible_end;
     f(x_start, y_start, x_end - x_start, y_end - y_start);
     y_start = y_end;
     x_start = 0;
@@ -1127,6 +2619,7 @@ template <class F> static void iterate_highlight_rectangles(
 static void draw_lines(
   GtkWidget *widget,
   cairo_t *cr,
+  double scroll_x,
   double allocated_width,
   double start_row,
   double end_row,
@@ -1139,11 +2632,11 @@ static void draw_lines(
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
   for (const auto &highlight : highlights) {
     const char *class_ = highlight.second;
-    const std::vector<std::string> path = {
-      "highlights",
-      std::string("highlight ") + class_,
-      std::string("region ") + class_
-    };
+    std::vector<std::string> &path = priv->frame->highlight_path;
+    path[1].assign("highlight ");
+    path[1].append(class_);
+    path[2].assign("region ");
+    path[2].append(class_);
     GdkRGBA background_color;
     priv->style_cache->get_property(widget, path, "background-color", &background_color);
     GtkBorderStyle border_bottom_style;
@@ -1153,7 +2646,7 @@ static void draw_lines(
       priv->style_cache->get_property(widget, path, "border-bottom-width", &border_bottom_width);
     }
     gdk_cairo_set_source_rgba(cr, &background_color);
-    iterate_highlight_rectangles(priv, allocated_width, start_row, end_row, layouts, highlight, [&](double x, double y, double width, double height) {
+    iterate_highlight_rectangles(priv, scroll_x + allocated_width, start_row, end_row, layouts, highlight, [&](double x, double y, double width, double height) {
       cairo_rectangle(cr, x, y, width, height - border_bottom_width);
     });
     cairo_fill(cr);
@@ -1161,31 +2654,33 @@ static void draw_lines(
       GdkRGBA border_bottom_color;
       priv->style_cache->get_property(widget, path, "border-bottom-color", &border_bottom_color);
       gdk_cairo_set_source_rgba(cr, &border_bottom_color);
-      iterate_highlight_rectangles(priv, allocated_width, start_row, end_row, layouts, highlight, [&](double x, double y, double width, double height) {
+      iterate_highlight_rectangles(priv, scroll_x + allocated_width, start_row, end_row, layouts, highlight, [&](double x, double y, double width, double height) {
         cairo_rectangle(cr, x, y + height - border_bottom_width, width, border_bottom_width);
       });
       cairo_fill(cr);
     }
   }
+  static const std::vector<std::string> root_path;
+  static const std::vector<std::string> cursor_path = {"cursor"};
   GdkRGBA text_color;
-  priv->style_cache->get_property(widget, {}, "color", &text_color);
+  priv->style_cache->get_property(widget, root_path, "color", &text_color);
   for (double row = start_row; row < end_row; row++) {
     double y = row * priv->line_height;
     if (!line_classes[row - start_row].empty()) {
       GdkRGBA background_color;
-      priv->style_cache->get_property(widget, {"line " + line_classes[row - start_row]}, "background-color", &background_color);
+      priv->style_cache->get_property(widget, set_path_element(priv->frame->line_path, 0, "line ", line_classes[row - start_row]), "background-color", &background_color);
       gdk_cairo_set_source_rgba(cr, &background_color);
-      cairo_rectangle(cr, 0, y, allocated_width, priv->line_height);
+      cairo_rectangle(cr, scroll_x, y, allocated_width, priv->line_height);
       cairo_fill(cr);
     }
     gdk_cairo_set_source_rgba(cr, &text_color);
-    layouts[row - start_row].draw(cr, 0, y + priv->ascent);
+    layouts[row - start_row].draw(cr, 0, y + priv->ascent, scroll_x, scroll_x + allocated_width);
   }
   GdkRGBA cursor_color;
-  priv->style_cache->get_property(widget, {"cursor"}, "border-left-color", &cursor_color);
+  priv->style_cache->get_property(widget, cursor_path, "border-left-color", &cursor_color);
   gdk_cairo_set_source_rgba(cr, &cursor_color);
   gint cursor_width;
-  priv->style_cache->get_property(widget, {"cursor"}, "border-left-width", &cursor_width);
+  priv->style_cache->get_property(widget, cursor_path, "border-left-width", &cursor_width);
   if (priv->draw_cursors) {
     for (const auto &cursor : cursors) {
       double y = cursor.first * priv->line_height;
@@ -1196,56 +2691,123 @@ static void draw_lines(
   }
 }
 
+// highlight and lay out one page above and below the visible rows while the main loop is idle
+static gboolean prewarm_callback(gpointer user_data) {
+  AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(user_data);
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  priv->prewarm_source_id = 0;
+  const double screen_line_count = get_screen_line_count(self);
+  const double vadjustment = gtk_adjustment_get_value(priv->vadjustment);
+  const double page_rows = ceil(gtk_widget_get_allocated_height(GTK_WIDGET(self)) / priv->line_height);
+  const double start_row = fmin(floor(vadjustment / priv->line_height), screen_line_count);
+  const double end_row = fmin(start_row + page_rows, screen_line_count);
+  const double margin_start_row = fmax(start_row - page_rows, 0.0);
+  const double margin_end_row = fmin(end_row + page_rows, screen_line_count);
+  if (margin_start_row < start_row) {
+    priv->layout_cache->get_layouts(self, priv->text_editor->displayLayer->getScreenLines(margin_start_row, start_row));
+  }
+  if (end_row < margin_end_row) {
+    priv->layout_cache->get_layouts(self, priv->text_editor->displayLayer->getScreenLines(end_row, margin_end_row));
+  }
+  // the layouts prepared here do not call for another round
+  priv->layout_cache->take_created();
+  return G_SOURCE_REMOVE;
+}
+
 static gboolean atom_text_editor_widget_draw(GtkWidget *widget, cairo_t *cr) {
   AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(widget);
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
 
-  priv->layout_cache->increment_generation();
   priv->style_cache->increment_generation();
 
   const double allocated_width = gtk_widget_get_allocated_width(widget);
   const double allocated_height = gtk_widget_get_allocated_height(widget);
   const double vadjustment = gtk_adjustment_get_value(priv->vadjustment);
 
-  const double start_row = fmin(floor(vadjustment / priv->line_height), priv->text_editor->getScreenLineCount());
-  const double end_row = fmin(ceil((allocated_height + vadjustment) / priv->line_height), priv->text_editor->getScreenLineCount());
-  auto screen_lines = priv->text_editor->displayLayer->getScreenLines(start_row, end_row);
+  const double screen_line_count = get_screen_line_count(self);
+  if (screen_line_count != priv->screen_line_count) {
+    // the estimate gets more precise as the wrap index grows
+    queue_update(self, PENDING_UPDATE_SCROLL_RANGE);
+  }
+  const double start_row = fmin(floor(vadjustment / priv->line_height), screen_line_count);
+  auto screen_lines = priv->text_editor->displayLayer->getScreenLines(start_row, fmin(ceil((allocated_height + vadjustment) / priv->line_height), screen_line_count));
+  // the count is only an estimate until the wrap index reaches the end of the buffer
+  const double end_row = start_row + screen_lines.size();
   auto decorations = priv->text_editor->decorationManager->decorationPropertiesByMarkerForScreenRowRange(start_row, end_row);
 
-  std::vector<std::string> line_classes(screen_lines.size());
-  std::vector<std::string> gutter_classes(screen_lines.size());
-  std::vector<std::pair<Range, const char *>> highlights;
-  std::vector<std::pair<int32_t, int32_t>> cursors;
+  // the screen lines and decorations are returned by value from the display layer, everything else reuses the previous frame's capacity
+  FrameScratch *frame = priv->frame;
+  frame->line_classes.resize(screen_lines.size());
+  frame->gutter_classes.resize(screen_lines.size());
+  for (size_t i = 0; i < screen_lines.size(); i++) {
+    frame->line_classes[i].clear();
+    frame->gutter_classes[i].clear();
+  }
+  frame->highlights.clear();
+  frame->cursors.clear();
   for (const auto &decoration : decorations) {
-    parse_decoration(start_row, end_row, decoration, line_classes, gutter_classes, highlights, cursors);
+    parse_decoration(start_row, end_row, decoration, frame->line_classes, frame->gutter_classes, frame->highlights, frame->cursors);
   }
 
-  std::vector<Layout> layouts = priv->layout_cache->get_layouts(self, screen_lines);
+  priv->layout_cache->get_layouts(self, screen_lines, frame->layouts);
+
+  // the horizontal scroll range follows the widest visible line
+  double scroll_width = 0;
+  for (const Layout &layout : frame->layouts) {
+    scroll_width = fmax(scroll_width, layout.get_width());
+  }
+  if (scroll_width != priv->scroll_width) {
+    priv->scroll_width = scroll_width;
+    queue_update(self, PENDING_UPDATE_SCROLL_RANGE);
+  }
+  const double hadjustment = priv->hadjustment ? gtk_adjustment_get_value(priv->hadjustment) : 0;
 
   const double padding = round(priv->char_width);
 
+  static const std::vector<std::string> root_path;
   GdkRGBA background_color;
-  priv->style_cache->get_property(widget, {}, "background-color", &background_color);
+  priv->style_cache->get_property(widget, root_path, "background-color", &background_color);
   gdk_cairo_set_source_rgba(cr, &background_color);
   cairo_paint(cr);
 
   cairo_save(cr);
   cairo_translate(cr, 0, -vadjustment);
-  draw_gutter(widget, cr, padding, priv->gutter_width, start_row, end_row, gutter_classes);
+  draw_gutter(widget, cr, padding, priv->gutter_width, start_row, end_row, frame->gutter_classes);
   cairo_restore(cr);
   cairo_save(cr);
-  cairo_translate(cr, priv->gutter_width, -vadjustment);
-  draw_lines(widget, cr, allocated_width - priv->gutter_width, start_row, end_row, line_classes, highlights, cursors, layouts);
+  cairo_rectangle(cr, priv->gutter_width, 0, allocated_width - priv->gutter_width, allocated_height);
+  cairo_clip(cr);
+  cairo_translate(cr, priv->gutter_width - hadjustment, -vadjustment);
+  draw_lines(widget, cr, hadjustment, allocated_width - priv->gutter_width, start_row, end_row, frame->line_classes, frame->highlights, frame->cursors, frame->layouts);
   cairo_restore(cr);
 
-  priv->layout_cache->collect_garbage();
   priv->style_cache->collect_garbage();
 
+  // frames that only redraw, like the blinking cursor, keep the layouts and do not prepare any
+  if (priv->layout_cache->take_created() || start_row != priv->prewarmed_start_row || end_row != priv->prewarmed_end_row) {
+    priv->prewarmed_start_row = start_row;
+    priv->prewarmed_end_row = end_row;
+    priv->layout_cache->collect_garbage();
+    priv->layout_cache->increment_generation();
+    if (!priv->prewarm_source_id) {
+      priv->prewarm_source_id = g_idle_add_full(G_PRIORITY_LOW, prewarm_callback, self, NULL);
+    }
+  }
+
   return GDK_EVENT_STOP;
 }
 
 static gboolean atom_text_editor_widget_key_press_event(GtkWidget *widget, GdkEventKey *event) {
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(widget);
+  if (priv->paste_job) {
+    // escape stops the paste and keeps what has been inserted, other keys wait for the paste to finish
+    if (event->keyval == GDK_KEY_Escape) {
+      free_paste_job(ATOM_TEXT_EDITOR_WIDGET(widget), true);
+    } else {
+      priv->paste_job->queued_events.push_back(gdk_event_copy((GdkEvent *)event));
+    }
+    return GDK_EVENT_STOP;
+  }
   if (GTK_WIDGET_CLASS(atom_text_editor_widget_parent_class)->key_press_event(widget, event) || gtk_im_context_filter_keypress(priv->im_context, event)) {
     return GDK_EVENT_STOP;
   }
@@ -1254,6 +2816,10 @@ static gboolean atom_text_editor_widget_key_press_event(GtkWidget *widget, GdkEv
 
 static gboolean atom_text_editor_widget_key_release_event(GtkWidget *widget, GdkEventKey *event) {
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(widget);
+  if (priv->paste_job) {
+    priv->paste_job->queued_events.push_back(gdk_event_copy((GdkEvent *)event));
+    return GDK_EVENT_STOP;
+  }
   if (GTK_WIDGET_CLASS(atom_text_editor_widget_parent_class)->key_release_event(widget, event) || gtk_im_context_filter_keypress(priv->im_context, event)) {
     return GDK_EVENT_STOP;
   }
@@ -1264,7 +2830,10 @@ static void atom_text_editor_widget_handle_commit(GtkIMContext *im_context, gcha
   AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(user_data);
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
   gunichar2 *utf16 = g_utf8_to_utf16(text, -1, NULL, NULL, NULL);
-  priv->bracket_matcher->insertText((const char16_t *)utf16, true);
+  // with many cursors plain text is inserted at all of them in one pass over the buffer
+  if (!priv->text_editor->hasMultipleCursors() || !insert_text_at_selections(priv->text_editor, (const char16_t *)utf16)) {
+    priv->bracket_matcher->insertText((const char16_t *)utf16, true);
+  }
   g_free(utf16);
 }
 
@@ -1307,6 +2876,11 @@ static void atom_text_editor_widget_handle_pressed(GtkGestureMultiPress *multipr
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
   const double vadjustment = gtk_adjustment_get_value(priv->vadjustment);
   gtk_widget_grab_focus(GTK_WIDGET(self));
+  if (priv->paste_job) {
+    // the context menu could edit the buffer under the paste, clicks are ignored until it is done
+    gtk_gesture_set_state(GTK_GESTURE(multipress_gesture), GTK_EVENT_SEQUENCE_DENIED);
+    return;
+  }
   GdkEventSequence *sequence = gtk_gesture_single_get_current_sequence(GTK_GESTURE_SINGLE(multipress_gesture));
   guint button = gtk_gesture_single_get_current_button(GTK_GESTURE_SINGLE(multipress_gesture));
   const GdkEvent *event = gtk_gesture_get_last_event(GTK_GESTURE(multipress_gesture), sequence);
@@ -1414,10 +2988,44 @@ static void atom_text_editor_widget_handle_drag_update(GtkGestureDrag *drag_gest
   }
 }
 
+// an estimate from the rows the display layer has indexed so far, it never indexes the rest of the buffer
+static double get_screen_line_count(AtomTextEditorWidget *self) {
+  return GET_PRIVATE(self)->text_editor->getApproximateScreenLineCount();
+}
+
+// the display layer only rewraps the edited rows, a new wrap column makes it index again on
+// demand up to the rows that are asked for, so the first visible buffer row is kept in place
+static void apply_soft_wrap(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  double width_in_chars = 0;
+  if (priv->soft_wrapped) {
+    const double padding = round(priv->char_width);
+    width_in_chars = fmax(floor((gtk_widget_get_allocated_width(GTK_WIDGET(self)) - priv->gutter_width - padding) / priv->char_width), 1.0);
+  }
+  if (width_in_chars == priv->wrap_width_in_chars) return;
+  double top_buffer_row = 0;
+  if (priv->vadjustment && priv->pending_scroll_row < 0) {
+    top_buffer_row = priv->text_editor->bufferRowForScreenRow(floor(gtk_adjustment_get_value(priv->vadjustment) / priv->line_height));
+  }
+  priv->wrap_width_in_chars = width_in_chars;
+  if (priv->soft_wrapped) {
+    priv->text_editor->setEditorWidthInChars(width_in_chars);
+  }
+  priv->text_editor->setSoftWrapped(priv->soft_wrapped);
+  if (priv->vadjustment && priv->pending_scroll_row < 0) {
+    priv->pending_scroll_row = priv->text_editor->screenPositionForBufferPosition(Point(top_buffer_row, 0)).row;
+  }
+  if (priv->hadjustment && priv->soft_wrapped) {
+    gtk_adjustment_set_value(priv->hadjustment, 0);
+  }
+  queue_update(self, PENDING_UPDATE_CONTENT);
+}
+
 static void update(AtomTextEditorWidget *self, bool redraw) {
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
   const double padding = round(priv->char_width);
-  const double gutter_width = padding * 4 + round(count_digits(priv->text_editor->getScreenLineCount()) * priv->char_width);
+  // the gutter shows buffer rows, counting them does not need the wrap index
+  const double gutter_width = padding * 4 + round(count_digits(priv->text_editor->getBuffer()->getLineCount()) * priv->char_width);
   if (gutter_width != priv->gutter_width) {
     priv->gutter_width = gutter_width;
     GtkAllocation allocation;
@@ -1426,7 +3034,8 @@ static void update(AtomTextEditorWidget *self, bool redraw) {
   }
   if (priv->vadjustment) {
     const double page_size = gtk_widget_get_allocated_height(GTK_WIDGET(self));
-    const double upper = fmax(priv->text_editor->getScreenLineCount() * priv->line_height, page_size);
+    priv->screen_line_count = get_screen_line_count(self);
+    const double upper = fmax(priv->screen_line_count * priv->line_height, page_size);
     const double max_value = fmax(upper - page_size, 0.0);
     g_object_freeze_notify(G_OBJECT(priv->vadjustment));
     gtk_adjustment_set_page_size(priv->vadjustment, page_size);
@@ -1434,11 +3043,77 @@ static void update(AtomTextEditorWidget *self, bool redraw) {
     if (gtk_adjustment_get_value(priv->vadjustment) > max_value) {
       gtk_adjustment_set_value(priv->vadjustment, max_value);
     }
+    if (priv->pending_scroll_row >= 0 && page_size > 0) {
+      gtk_adjustment_set_value(priv->vadjustment, fmin(priv->pending_scroll_row * priv->line_height, max_value));
+      priv->pending_scroll_row = -1;
+    }
     g_object_thaw_notify(G_OBJECT(priv->vadjustment));
   }
+  if (priv->hadjustment) {
+    const double page_size = fmax(gtk_widget_get_allocated_width(GTK_WIDGET(self)) - gutter_width, 0.0);
+    // the range only shrinks below the scrolled position once the view has been scrolled back
+    const double upper = fmax(fmax(priv->scroll_width + padding, page_size), gtk_adjustment_get_value(priv->hadjustment) + page_size);
+    g_object_freeze_notify(G_OBJECT(priv->hadjustment));
+    gtk_adjustment_set_page_size(priv->hadjustment, page_size);
+    gtk_adjustment_set_upper(priv->hadjustment, upper);
+    g_object_thaw_notify(G_OBJECT(priv->hadjustment));
+  }
   if (redraw) gtk_widget_queue_draw(GTK_WIDGET(self));
 }
 
+// buffer and selection changes only mark the widget dirty, the pending work is
+// done once per frame no matter how many changes happened in between
+static gboolean tick_callback(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data) {
+  AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(widget);
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  const guint pending_updates = priv->pending_updates;
+  priv->pending_updates = 0;
+  priv->tick_callback_id = 0;
+  if (pending_updates & PENDING_UPDATE_CONTENT) {
+    update(self);
+  } else if (pending_updates & PENDING_UPDATE_SCROLL_RANGE) {
+    update(self, false);
+  }
+  if (pending_updates & PENDING_UPDATE_SELECTIONS) {
+    // only notify the status bar when the values it displays actually changed
+    const Point cursor_position = priv->text_editor->getCursorBufferPosition();
+    if (cursor_position.row != priv->cursor_position.row || cursor_position.column != priv->cursor_position.column) {
+      priv->cursor_position = cursor_position;
+      g_object_notify(G_OBJECT(self), "cursor-position");
+    }
+    const Range selected_range = priv->text_editor->getSelectedBufferRange();
+    if (selected_range.start.row != priv->selected_range.start.row || selected_range.start.column != priv->selected_range.start.column || selected_range.end.row != priv->selected_range.end.row || selected_range.end.column != priv->selected_range.end.column) {
+      priv->selected_range = selected_range;
+      g_object_notify(G_OBJECT(self), "selection-count");
+    }
+    start_blinking(self);
+  } else if ((pending_updates & PENDING_UPDATE_CONTENT) && !priv->selected_range.isEmpty()) {
+    // an edit inside the selection can change the count without moving its ends
+    g_object_notify(G_OBJECT(self), "selection-count");
+  }
+  if (pending_updates & PENDING_UPDATE_BRACKETS) {
+    update_bracket_matches(self);
+  }
+  if (pending_updates & PENDING_UPDATE_AUTOSCROLL) {
+    if (gtk_adjustment_get_page_size(priv->vadjustment) > 0) {
+      priv->autoscroll_pending = false;
+      autoscroll(self, priv->autoscroll_range);
+    } else {
+      // a newly opened tab has not been allocated yet, size_allocate scrolls once it is
+      priv->autoscroll_pending = true;
+    }
+  }
+  return G_SOURCE_REMOVE;
+}
+
+static void queue_update(AtomTextEditorWidget *self, guint pending_updates) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  priv->pending_updates |= pending_updates;
+  if (!priv->tick_callback_id) {
+    priv->tick_callback_id = gtk_widget_add_tick_callback(GTK_WIDGET(self), tick_callback, NULL, NULL);
+  }
+}
+
 static void autoscroll(AtomTextEditorWidget *self, const Range &range) {
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
   const double min_value = fmin((range.end.row + 1) * priv->line_height + 50, gtk_adjustment_get_upper(priv->vadjustment)) - gtk_adjustment_get_page_size(priv->vadjustment);
@@ -1449,6 +3124,19 @@ static void autoscroll(AtomTextEditorWidget *self, const Range &range) {
   if (gtk_adjustment_get_value(priv->vadjustment) < min_value) {
     gtk_adjustment_set_value(priv->vadjustment, min_value);
   }
+  if (priv->hadjustment && !priv->soft_wrapped) {
+    Layout layout = priv->layout_cache->get_layout(self, priv->text_editor->displayLayer->getScreenLine(range.end.row));
+    const double x = layout.index_to_x(range.end.column);
+    const double margin = priv->char_width * 4;
+    const double page_size = gtk_adjustment_get_page_size(priv->hadjustment);
+    if (x - margin < gtk_adjustment_get_value(priv->hadjustment)) {
+      gtk_adjustment_set_value(priv->hadjustment, fmax(x - margin, 0.0));
+    } else if (x + margin > gtk_adjustment_get_value(priv->hadjustment) + page_size) {
+      // the row might not have been drawn yet, so the range might not include it
+      gtk_adjustment_set_upper(priv->hadjustment, fmax(gtk_adjustment_get_upper(priv->hadjustment), x + margin));
+      gtk_adjustment_set_value(priv->hadjustment, x + margin - page_size);
+    }
+  }
 }
 
 static gboolean blink_callback(gpointer user_data) {
@@ -1484,9 +3172,12 @@ static Point get_screen_position(AtomTextEditorWidget *self, double x, double y)
   const double vadjustment = gtk_adjustment_get_value(priv->vadjustment);
   const double row = fmax(floor((y + vadjustment) / priv->line_height), 0.0);
   double column;
-  if (row < priv->text_editor->getScreenLineCount()) {
-    Layout layout = priv->layout_cache->get_layout(self, priv->text_editor->displayLayer->getScreenLine(row));
-    column = layout.x_to_index(x - priv->gutter_width);
+  // getScreenLines stops at the last row, unlike getScreenLineCount it never indexes the whole buffer
+  auto screen_lines = priv->text_editor->displayLayer->getScreenLines(row, row + 1);
+  if (!screen_lines.empty()) {
+    Layout layout = priv->layout_cache->get_layout(self, screen_lines[0]);
+    const double hadjustment = priv->hadjustment ? gtk_adjustment_get_value(priv->hadjustment) : 0;
+    column = layout.x_to_index(x - priv->gutter_width + hadjustment);
   } else {
     column = 0;
   }
@@ -1641,7 +3332,13 @@ static void atom_text_editor_widget_add_selection_below(AtomTextEditorWidget *se
 }
 
 static void atom_text_editor_widget_select_next(AtomTextEditorWidget *self) {
-  GET_PRIVATE(self)->select_next->findAndSelectNext();
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  if (priv->text_editor->getSelectedBufferRange().isEmpty()) {
+    // select the word under the cursor
+    priv->select_next->findAndSelectNext();
+  } else {
+    select_next_occurrence(self);
+  }
 }
 
 static void atom_text_editor_widget_insert_newline(AtomTextEditorWidget *self) {
@@ -1718,34 +3415,722 @@ static void atom_text_editor_widget_redo(AtomTextEditorWidget *self) {
   GET_PRIVATE(self)->text_editor->redo();
 }
 
-static void atom_text_editor_widget_copy(AtomTextEditorWidget *self) {
+static void primary_get_func(GtkClipboard *clipboard, GtkSelectionData *selection_data, guint info, gpointer user_data_or_owner) {
+  AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(user_data_or_owner);
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
-  priv->text_editor->copySelectedText();
-  const std::u16string &text = priv->text_editor->clipboard.systemText;
+  std::u16string text;
+  if (priv->primary_text) {
+    text = *priv->primary_text;
+  } else {
+    text = priv->text_editor->getBuffer()->getTextInRange(priv->primary_range);
+  }
   gchar *utf8 = g_utf16_to_utf8((const gunichar2 *)text.c_str(), text.size(), NULL, NULL, NULL);
-  GtkClipboard *clipboard = gtk_widget_get_clipboard(GTK_WIDGET(self), GDK_SELECTION_CLIPBOARD);
-  gtk_clipboard_set_text(clipboard, utf8, -1);
+  gtk_selection_data_set_text(selection_data, utf8, -1);
+  g_free(utf8);
+}
+
+static void primary_clear_func(GtkClipboard *clipboard, gpointer user_data_or_owner) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(user_data_or_owner);
+  delete priv->primary_text;
+  priv->primary_text = nullptr;
+}
+
+// PRIMARY only remembers the selected range, the text is copied and converted
+// when another application actually asks for it
+static void update_primary_selection(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  GtkClipboard *clipboard = gtk_widget_get_clipboard(GTK_WIDGET(self), GDK_SELECTION_PRIMARY);
+  const bool is_owner = gtk_clipboard_get_owner(clipboard) == G_OBJECT(self);
+  const Range range = priv->text_editor->getSelectedBufferRange();
+  if (!range.isEmpty()) {
+    if (is_owner) {
+      delete priv->primary_text;
+      priv->primary_text = nullptr;
+    } else {
+      GtkTargetList *target_list = gtk_target_list_new(NULL, 0);
+      gtk_target_list_add_text_targets(target_list, 0);
+      gint n_targets;
+      GtkTargetEntry *targets = gtk_target_table_new_from_list(target_list, &n_targets);
+      gtk_clipboard_set_with_owner(clipboard, targets, n_targets, primary_get_func, primary_clear_func, G_OBJECT(self));
+      gtk_target_table_free(targets, n_targets);
+      gtk_target_list_unref(target_list);
+    }
+    priv->primary_range = range;
+    priv->primary_range_changed = false;
+  } else if (is_owner && !priv->primary_text) {
+    // keep offering the previously selected text after the selection has been
+    // collapsed, unless the buffer was edited in the meantime
+    if (priv->primary_range_changed) {
+      gtk_clipboard_clear(clipboard);
+    } else {
+      priv->primary_text = new std::u16string(priv->text_editor->getBuffer()->getTextInRange(priv->primary_range));
+    }
+  }
+}
+
+static void clipboard_get_func(GtkClipboard *clipboard, GtkSelectionData *selection_data, guint info, gpointer user_data_or_owner) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(user_data_or_owner);
+  gchar *utf8 = utf16_to_utf8_chunked(priv->text_editor->clipboard.systemText);
+  gtk_selection_data_set_text(selection_data, utf8, -1);
   g_free(utf8);
 }
 
+static void clipboard_clear_func(GtkClipboard *clipboard, gpointer user_data_or_owner) {
+}
+
+// the copied text stays in the editor's clipboard and is only converted when it is pasted
+static void set_clipboard(AtomTextEditorWidget *self) {
+  GtkClipboard *clipboard = gtk_widget_get_clipboard(GTK_WIDGET(self), GDK_SELECTION_CLIPBOARD);
+  GtkTargetList *target_list = gtk_target_list_new(NULL, 0);
+  gtk_target_list_add_text_targets(target_list, 0);
+  gint n_targets;
+  GtkTargetEntry *targets = gtk_target_table_new_from_list(target_list, &n_targets);
+  gtk_clipboard_set_with_owner(clipboard, targets, n_targets, clipboard_get_func, clipboard_clear_func, G_OBJECT(self));
+  gtk_clipboard_set_can_store(clipboard, targets, n_targets);
+  gtk_target_table_free(targets, n_targets);
+  gtk_target_list_unref(target_list);
+}
+
+static void atom_text_editor_widget_copy(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  priv->text_editor->copySelectedText();
+  set_clipboard(self);
+}
+
 static void atom_text_editor_widget_cut(AtomTextEditorWidget *self) {
   AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
   priv->text_editor->cutSelectedText();
-  const std::u16string &text = priv->text_editor->clipboard.systemText;
-  gchar *utf8 = g_utf16_to_utf8((const gunichar2 *)text.c_str(), text.size(), NULL, NULL, NULL);
-  GtkClipboard *clipboard = gtk_widget_get_clipboard(GTK_WIDGET(self), GDK_SELECTION_CLIPBOARD);
-  gtk_clipboard_set_text(clipboard, utf8, -1);
-  g_free(utf8);
+  set_clipboard(self);
+}
+
+static bool insert_paste_chunk(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  PasteJob *job = priv->paste_job;
+  size_t end = std::min(job->position + PASTE_CHUNK_SIZE, job->length);
+  std::u16string chunk;
+  if (job->utf8) {
+    // move back to the start of a character
+    if (end < job->length) {
+      while ((job->utf8[end] & 0xC0) == 0x80) end--;
+    }
+    glong length;
+    gunichar2 *utf16 = g_utf8_to_utf16(job->utf8 + job->position, end - job->position, NULL, &length, NULL);
+    if (utf16) {
+      chunk.assign((const char16_t *)utf16, length);
+      g_free(utf16);
+    }
+  } else {
+    // do not split a surrogate pair
+    if (end < job->length && job->utf16[end] >= 0xDC00 && job->utf16[end] <= 0xDFFF) end--;
+    chunk.assign(job->utf16, job->position, end - job->position);
+  }
+  if (!chunk.empty()) {
+    // the cursor follows the inserted text unless it has been moved away meanwhile
+    const bool follow = compare_points(priv->text_editor->getCursorBufferPosition(), job->insertion_point) == 0;
+    const Range range = priv->text_editor->setTextInBufferRange(Range(job->insertion_point, job->insertion_point), chunk);
+    job->insertion_point = range.end;
+    if (follow) {
+      priv->text_editor->setCursorBufferPosition(range.end);
+    }
+  }
+  job->position = end;
+  g_object_notify(G_OBJECT(self), "progress");
+  return job->position < job->length;
+}
+
+static void free_paste_job(AtomTextEditorWidget *self, bool handle_queued_events) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  PasteJob *job = priv->paste_job;
+  if (job->source_id) {
+    g_source_remove(job->source_id);
+  }
+  priv->paste_job = nullptr;
+  // the chunks are undone as a single change, which restores the selections from before the paste
+  priv->text_editor->groupChangesSinceCheckpoint(job->checkpoint);
+  const std::vector<GdkEvent *> queued_events = std::move(job->queued_events);
+  g_free(job->utf8);
+  delete job;
+  g_object_notify(G_OBJECT(self), "progress");
+  for (GdkEvent *event : queued_events) {
+    if (handle_queued_events) {
+      // a queued paste queues the keys after it again
+      if (event->type == GDK_KEY_PRESS) {
+        atom_text_editor_widget_key_press_event(GTK_WIDGET(self), &event->key);
+      } else {
+        atom_text_editor_widget_key_release_event(GTK_WIDGET(self), &event->key);
+      }
+    }
+    gdk_event_free(event);
+  }
+}
+
+static void finish_paste(AtomTextEditorWidget *self) {
+  while (insert_paste_chunk(self));
+  free_paste_job(self, true);
+}
+
+// keeps the chunks that have been inserted so far and drops the queued keys
+static void cancel_paste(AtomTextEditorWidget *self) {
+  if (GET_PRIVATE(self)->paste_job) {
+    free_paste_job(self, false);
+  }
+}
+
+static gboolean paste_callback(gpointer user_data) {
+  AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(user_data);
+  if (insert_paste_chunk(self)) {
+    return G_SOURCE_CONTINUE;
+  }
+  GET_PRIVATE(self)->paste_job->source_id = 0;
+  finish_paste(self);
+  return G_SOURCE_REMOVE;
+}
+
+// a large paste into a single selection is inserted in chunks from an idle callback so that
+// the editor stays responsive, the selected text is replaced right away
+static void start_paste(AtomTextEditorWidget *self, PasteJob *job) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  job->position = 0;
+  job->checkpoint = priv->text_editor->createCheckpoint();
+  job->insertion_point = priv->text_editor->setTextInBufferRange(priv->text_editor->getSelectedBufferRange(), u"").start;
+  priv->text_editor->setCursorBufferPosition(job->insertion_point);
+  job->source_id = g_idle_add(paste_callback, self);
+  priv->paste_job = job;
+  g_object_notify(G_OBJECT(self), "progress");
 }
 
 static void atom_text_editor_widget_paste(AtomTextEditorWidget *self) {
+  if (GET_PRIVATE(self)->paste_job) return;
   GtkClipboard *clipboard = gtk_widget_get_clipboard(GTK_WIDGET(self), GDK_SELECTION_CLIPBOARD);
   gtk_clipboard_request_text(clipboard, [](GtkClipboard *clipboard, const gchar *text, gpointer user_data) {
     AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(user_data);
     AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
-    gunichar2 *utf16 = g_utf8_to_utf16(text, -1, NULL, NULL, NULL);
-    priv->text_editor->clipboard.systemText = (const char16_t *)utf16;
-    priv->text_editor->pasteText();
-    g_free(utf16);
+    if (!text) return;
+    if (gtk_clipboard_get_owner(clipboard) == G_OBJECT(self)) {
+      // copied from this editor, the editor's clipboard already holds the text
+      const std::u16string &system_text = priv->text_editor->clipboard.systemText;
+      if (system_text.size() <= PASTE_CHUNK_SIZE || priv->text_editor->hasMultipleCursors()) {
+        priv->text_editor->pasteText();
+        return;
+      }
+      PasteJob *job = new PasteJob();
+      job->utf8 = NULL;
+      job->utf16 = system_text;
+      job->length = system_text.size();
+      start_paste(self, job);
+      return;
+    }
+    const size_t size = strlen(text);
+    if (size <= PASTE_CHUNK_SIZE || priv->text_editor->hasMultipleCursors()) {
+      gunichar2 *utf16 = g_utf8_to_utf16(text, size, NULL, NULL, NULL);
+      priv->text_editor->clipboard.systemText = (const char16_t *)utf16;
+      priv->text_editor->pasteText();
+      g_free(utf16);
+      return;
+    }
+    PasteJob *job = new PasteJob();
+    job->utf8 = g_strndup(text, size);
+    job->length = size;
+    start_paste(self, job);
+  }, self);
+}
+
+gdouble atom_text_editor_widget_get_progress(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  if (!priv->paste_job) {
+    return 0.0;
+  }
+  PasteJob *job = priv->paste_job;
+  return (double)job->position / (double)job->length;
+}
+
+static std::u16string utf8_to_utf16(const gchar *text) {
+  glong length;
+  gunichar2 *utf16 = g_utf8_to_utf16(text, -1, NULL, &length, NULL);
+  if (!utf16) {
+    return std::u16string();
+  }
+  std::u16string result((const char16_t *)utf16, length);
+  g_free(utf16);
+  return result;
+}
+
+struct SearchTask {
+  AtomTextEditorWidget *self;
+  std::shared_ptr<BufferSearch> search;
+  std::u16string text;
+};
+
+struct SearchResults {
+  AtomTextEditorWidget *self;
+  GCancellable *cancellable;
+  std::vector<Range> ranges;
+  bool done;
+};
+
+static gboolean add_search_results(gpointer user_data) {
+  SearchResults *results = (SearchResults *)user_data;
+  // the widget might already be gone if the search was cancelled
+  if (g_cancellable_is_cancelled(results->cancellable)) {
+    return G_SOURCE_REMOVE;
+  }
+  FindState *find = GET_PRIVATE(results->self)->find;
+  for (const Range &range : results->ranges) {
+    find->markers.push_back(find->marker_layer->markBufferRange(range));
+  }
+  if (results->done) {
+    find->searching = false;
+  }
+  g_object_notify(G_OBJECT(results->self), "match-count");
+  if (results->done && find->replace_all_pending) {
+    find->replace_all_pending = false;
+    std::vector<Range> ranges;
+    for (DisplayMarker *marker : find->markers) {
+      ranges.push_back(marker->getBufferRange());
+    }
+    replace_ranges(results->self, ranges, find->replacement);
+  }
+  return G_SOURCE_REMOVE;
+}
+
+static void post_search_results(AtomTextEditorWidget *self, GCancellable *cancellable, std::vector<Range> &&ranges, bool done) {
+  SearchResults *results = new SearchResults{self, G_CANCELLABLE(g_object_ref(cancellable)), std::move(ranges), done};
+  g_main_context_invoke_full(NULL, G_PRIORITY_DEFAULT_IDLE, add_search_results, results, [](gpointer user_data) {
+    SearchResults *results = (SearchResults *)user_data;
+    g_object_unref(results->cancellable);
+    delete results;
+  });
+}
+
+static void search_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+  SearchTask *search_task = (SearchTask *)task_data;
+  search_task->search->search(search_task->text, cancellable, [&](std::vector<Range> &&ranges) {
+    post_search_results(search_task->self, cancellable, std::move(ranges), false);
+  });
+  post_search_results(search_task->self, cancellable, std::vector<Range>(), true);
+  g_task_return_boolean(task, TRUE);
+}
+
+static void stop_search(AtomTextEditorWidget *self) {
+  FindState *find = GET_PRIVATE(self)->find;
+  cancel_search(find);
+  find->searching = false;
+  find->marker_layer->clear();
+  find->markers.clear();
+}
+
+static void restart_search(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  FindState *find = priv->find;
+  stop_search(self);
+  if (find->search && find->search->is_valid()) {
+    // the worker thread searches a snapshot of the text
+    find->cancellable = g_cancellable_new();
+    find->searching = true;
+    SearchTask *search_task = new SearchTask{self, find->search, priv->text_editor->getBuffer()->getText()};
+    GTask *task = g_task_new(NULL, find->cancellable, NULL, NULL);
+    g_task_set_task_data(task, search_task, [](gpointer task_data) {
+      delete (SearchTask *)task_data;
+    });
+    g_task_run_in_thread(task, search_thread);
+    g_object_unref(task);
+  }
+  g_object_notify(G_OBJECT(self), "match-count");
+}
+
+gboolean atom_text_editor_widget_find(AtomTextEditorWidget *self, const gchar *pattern, gboolean regex, gboolean case_sensitive) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  FindState *find = priv->find;
+  if (find->timeout_id) {
+    g_source_remove(find->timeout_id);
+    find->timeout_id = 0;
+  }
+  find->replace_all_pending = false;
+  if (pattern[0] == '\0') {
+    find->search = nullptr;
+    stop_search(self);
+    g_object_notify(G_OBJECT(self), "match-count");
+    return TRUE;
+  }
+  find->search = std::make_shared<BufferSearch>(utf8_to_utf16(pattern), regex, case_sensitive);
+  restart_search(self);
+  return find->search->is_valid();
+}
+
+// the index of the first match that starts at or after position
+static size_t find_match_index(FindState *find, const Point &position) {
+  auto iterator = std::lower_bound(find->markers.begin(), find->markers.end(), position, [](DisplayMarker *marker, const Point &position) {
+    return compare_points(marker->getBufferRange().start, position) < 0;
+  });
+  return iterator - find->markers.begin();
+}
+
+void atom_text_editor_widget_find_next(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  FindState *find = priv->find;
+  if (find->markers.empty()) return;
+  size_t index = find_match_index(find, priv->text_editor->getSelectedBufferRange().end);
+  if (index == find->markers.size()) {
+    index = 0;
+  }
+  priv->text_editor->setSelectedBufferRange(find->markers[index]->getBufferRange());
+}
+
+void atom_text_editor_widget_find_previous(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  FindState *find = priv->find;
+  if (find->markers.empty()) return;
+  size_t index = find_match_index(find, priv->text_editor->getSelectedBufferRange().start);
+  if (index == 0) {
+    index = find->markers.size();
+  }
+  priv->text_editor->setSelectedBufferRange(find->markers[index - 1]->getBufferRange());
+}
+
+// expands the replacement for the match at range from a window of the text around it instead of the whole text
+static bool substitute_match(TextBuffer *buffer, const BufferSearch &search, const Range &range, const std::u16string &replacement, std::u16string &output) {
+  Point window_start(range.start.row, fmax(range.start.column - SUBSTITUTE_CONTEXT_LENGTH, 0.0));
+  // a window that starts or ends at a line boundary includes the line ending, which ^ and $ look at
+  if (window_start.column == 0 && window_start.row > 0) {
+    window_start = Point(window_start.row - 1, buffer->lineLengthForRow(window_start.row - 1));
+  }
+  const double last_row = buffer->getLastRow();
+  const double line_length = buffer->lineLengthForRow(range.end.row);
+  Point window_end(range.end.row, fmin(range.end.column + SUBSTITUTE_CONTEXT_LENGTH, line_length));
+  if (window_end.column == line_length && window_end.row < last_row) {
+    window_end = Point(window_end.row + 1, 0);
+  }
+  std::u16string text = buffer->getTextInRange(Range(window_start, range.start));
+  const size_t start = text.size();
+  text += buffer->getTextInRange(range);
+  const size_t end = text.size();
+  text += buffer->getTextInRange(Range(range.end, window_end));
+  const bool at_start = window_start.row == 0 && window_start.column == 0;
+  const bool at_end = window_end.row == last_row && window_end.column == buffer->lineLengthForRow(last_row);
+  return search.substitute(text, start, end, replacement, output, at_start, at_end);
+}
+
+gboolean atom_text_editor_widget_replace_next(AtomTextEditorWidget *self, const gchar *replacement) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  // the paste inserts at a fixed position that the replacements would move
+  if (priv->paste_job) {
+    finish_paste(self);
+  }
+  FindState *find = priv->find;
+  if (find->markers.empty()) return TRUE;
+  const Range selected_range = priv->text_editor->getSelectedBufferRange();
+  const size_t index = find_match_index(find, selected_range.start);
+  if (index < find->markers.size()) {
+    const Range range = find->markers[index]->getBufferRange();
+    if (compare_points(range.start, selected_range.start) == 0 && compare_points(range.end, selected_range.end) == 0) {
+      TextBuffer *buffer = priv->text_editor->getBuffer();
+      std::u16string replacement16;
+      if (!substitute_match(buffer, *find->search, range, utf8_to_utf16(replacement), replacement16)) {
+        return FALSE;
+      }
+      const Range new_range = buffer->setTextInRange(range, replacement16);
+      priv->text_editor->setCursorBufferPosition(new_range.end);
+    }
+  }
+  atom_text_editor_widget_find_next(self);
+  return TRUE;
+}
+
+// every replacement is expanded against the unchanged text before the first edit
+static gboolean replace_ranges(AtomTextEditorWidget *self, const std::vector<Range> &ranges, const std::u16string &replacement) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  FindState *find = priv->find;
+  TextBuffer *buffer = priv->text_editor->getBuffer();
+  std::vector<std::u16string> replacements(ranges.size());
+  for (size_t i = 0; i < ranges.size(); i++) {
+    if (!substitute_match(buffer, *find->search, ranges[i], replacement, replacements[i])) {
+      return FALSE;
+    }
+  }
+  // the matches are searched again after the edit, there is no need to keep the markers updated meanwhile
+  stop_search(self);
+  priv->text_editor->transact(0, [&]() {
+    for (size_t i = ranges.size(); i > 0; i--) {
+      buffer->setTextInRange(ranges[i - 1], replacements[i - 1]);
+    }
+  });
+  return TRUE;
+}
+
+gboolean atom_text_editor_widget_replace_all(AtomTextEditorWidget *self, const gchar *replacement) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  if (priv->paste_job) {
+    finish_paste(self);
+  }
+  FindState *find = priv->find;
+  if (!find->search || !find->search->is_valid()) return TRUE;
+  if (find->searching || find->timeout_id) {
+    // the markers are incomplete or outdated, replace once the worker thread has found all matches
+    if (find->timeout_id) {
+      g_source_remove(find->timeout_id);
+      find->timeout_id = 0;
+      restart_search(self);
+    }
+    find->replace_all_pending = true;
+    find->replacement = utf8_to_utf16(replacement);
+    return TRUE;
+  }
+  std::vector<Range> ranges;
+  for (DisplayMarker *marker : find->markers) {
+    ranges.push_back(marker->getBufferRange());
+  }
+  return replace_ranges(self, ranges, utf8_to_utf16(replacement));
+}
+
+gint atom_text_editor_widget_get_match_count(AtomTextEditorWidget *self) {
+  return GET_PRIVATE(self)->find->markers.size();
+}
+
+static bool is_word_character(char16_t c) {
+  return c == u'_' || g_unichar_isalnum(c);
+}
+
+// like in select-next, a selected whole word only matches other whole words
+static bool is_whole_word(TextBuffer *buffer, const Range &range) {
+  if (range.isEmpty() || range.start.row != range.end.row) return false;
+  const std::u16string line = buffer->lineForRow(range.start.row);
+  const size_t start = range.start.column;
+  const size_t end = range.end.column;
+  for (size_t i = start; i < end; i++) {
+    if (!is_word_character(line[i])) return false;
+  }
+  return (start == 0 || !is_word_character(line[start - 1])) && (end == line.size() || !is_word_character(line[end]));
+}
+
+static void select_next_occurrence(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  TextBuffer *buffer = priv->text_editor->getBuffer();
+  const Range last_range = priv->text_editor->getSelectedBufferRange();
+  OccurrenceIndex *occurrences = priv->occurrences;
+  const std::vector<Range> &ranges = occurrences->update(buffer, buffer->getTextInRange(last_range), is_whole_word(buffer, last_range));
+  if (ranges.empty()) return;
+  if (!occurrences->has_selection()) {
+    occurrences->set_selection(priv->text_editor->getSelectedBufferRanges());
+  }
+  // continue after the last selection and wrap around, skipping occurrences that are already selected
+  const size_t index = occurrences->find_unselected(last_range.end);
+  if (index == ranges.size()) return;
+  priv->selecting_occurrences = true;
+  priv->text_editor->addSelectionForBufferRange(ranges[index]);
+  priv->selecting_occurrences = false;
+  occurrences->select(index);
+}
+
+static void atom_text_editor_widget_select_all_occurrences(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  if (priv->text_editor->getSelectedBufferRange().isEmpty()) {
+    priv->select_next->findAndSelectNext();
+  }
+  TextBuffer *buffer = priv->text_editor->getBuffer();
+  const Range last_range = priv->text_editor->getSelectedBufferRange();
+  if (last_range.isEmpty()) return;
+  OccurrenceIndex *occurrences = priv->occurrences;
+  const std::vector<Range> &ranges = occurrences->update(buffer, buffer->getTextInRange(last_range), is_whole_word(buffer, last_range));
+  if (ranges.empty()) return;
+  priv->selecting_occurrences = true;
+  priv->text_editor->setSelectedBufferRanges(ranges);
+  priv->selecting_occurrences = false;
+  occurrences->select_all();
+}
+
+struct GitDiffTask {
+  std::shared_ptr<const std::vector<std::u16string>> head_lines;
+  std::u16string text;
+};
+
+static std::vector<std::u16string> split_lines(const std::u16string &text) {
+  std::vector<std::u16string> lines;
+  size_t start = 0;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == u'\n') {
+      lines.emplace_back(text, start, i - start);
+      start = i + 1;
+    }
+  }
+  lines.emplace_back(text, start, text.size() - start);
+  return lines;
+}
+
+static void mark_git_rows(GitState *git, GitLineStatus status, double start_row, double end_row, double last_row) {
+  git->marker_layers[status]->markBufferRange(Range(Point(std::min(start_row, last_row), 0), Point(std::min(end_row, last_row), 0)));
+}
+
+static void update_git_markers(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  GitState *git = priv->git;
+  for (int status = 0; status < GIT_LINE_STATUS_COUNT; status++) {
+    git->marker_layers[status]->clear();
+  }
+  const double last_row = priv->text_editor->getBuffer()->getLastRow();
+  for (const LineHunk &hunk : git->diff.get_hunks()) {
+    const double start_row = hunk.new_start;
+    if (hunk.old_count == 0) {
+      mark_git_rows(git, GIT_LINE_ADDED, start_row, start_row + hunk.new_count - 1, last_row);
+    } else if (hunk.new_count == 0) {
+      mark_git_rows(git, GIT_LINE_REMOVED, start_row, start_row, last_row);
+    } else {
+      // a line replaces one line in HEAD, the lines beyond those are new
+      const size_t modified_count = std::min(hunk.old_count, hunk.new_count);
+      mark_git_rows(git, GIT_LINE_MODIFIED, start_row, start_row + modified_count - 1, last_row);
+      if (hunk.new_count > modified_count) {
+        mark_git_rows(git, GIT_LINE_ADDED, start_row + modified_count, start_row + hunk.new_count - 1, last_row);
+      }
+    }
+  }
+  gtk_widget_queue_draw(GTK_WIDGET(self));
+}
+
+// diffs the hunks that edits touched, only their lines are read from the buffer
+static void update_git_diff(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  GitState *git = priv->git;
+  TextBuffer *buffer = priv->text_editor->getBuffer();
+  git->diff.update(*git->head_lines, [buffer](size_t row) {
+    return buffer->lineForRow(row);
+  });
+  update_git_markers(self);
+}
+
+static void git_diff_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+  GitDiffTask *diff_task = (GitDiffTask *)task_data;
+  const std::vector<std::u16string> &old_lines = *diff_task->head_lines;
+  const std::vector<std::u16string> new_lines = split_lines(diff_task->text);
+  std::vector<LineHunk> *hunks = new std::vector<LineHunk>(diff_lines(old_lines.data(), old_lines.size(), new_lines.data(), new_lines.size()));
+  g_task_return_pointer(task, hunks, [](gpointer hunks) {
+    delete (std::vector<LineHunk> *)hunks;
+  });
+}
+
+static void git_diff_ready(GObject *source_object, GAsyncResult *result, gpointer user_data) {
+  std::vector<LineHunk> *hunks = (std::vector<LineHunk> *)g_task_propagate_pointer(G_TASK(result), NULL);
+  // a cancelled diff returns nothing and the widget might already be gone
+  if (!hunks) return;
+  AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(user_data);
+  GitState *git = GET_PRIVATE(self)->git;
+  g_object_unref(git->diff_cancellable);
+  git->diff_cancellable = NULL;
+  // the worker diffed a snapshot, the edits made since then are applied on top
+  git->diff.set_hunks(std::move(*hunks));
+  delete hunks;
+  for (const BufferChange &change : git->changes) {
+    git->diff.add_change(change);
+  }
+  git->changes.clear();
+  if (git->diff.is_valid()) {
+    update_git_diff(self);
+  } else {
+    schedule_git_diff(self, 0);
+  }
+}
+
+// the whole text is only diffed on a worker thread when HEAD was loaded or after too many edits
+static void start_git_diff(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  GitState *git = priv->git;
+  if (git->diff_cancellable) {
+    g_cancellable_cancel(git->diff_cancellable);
+    g_object_unref(git->diff_cancellable);
+  }
+  git->diff_cancellable = g_cancellable_new();
+  git->changes.clear();
+  git->diff.invalidate();
+  // the worker thread diffs a snapshot of the text
+  GitDiffTask *diff_task = new GitDiffTask{git->head_lines, priv->text_editor->getBuffer()->getText()};
+  GTask *task = g_task_new(NULL, git->diff_cancellable, git_diff_ready, self);
+  g_task_set_task_data(task, diff_task, [](gpointer task_data) {
+    delete (GitDiffTask *)task_data;
+  });
+  g_task_run_in_thread(task, git_diff_thread);
+  g_object_unref(task);
+}
+
+static void schedule_git_diff(AtomTextEditorWidget *self, guint delay) {
+  GitState *git = GET_PRIVATE(self)->git;
+  if (!git->head_lines) return;
+  if (git->timeout_id) {
+    g_source_remove(git->timeout_id);
+  }
+  git->timeout_id = g_timeout_add(delay, [](gpointer user_data) -> gboolean {
+    AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(user_data);
+    GitState *git = GET_PRIVATE(self)->git;
+    git->timeout_id = 0;
+    // a running diff picks up the edits when it is done
+    if (!git->diff_cancellable) {
+      if (git->diff.is_valid()) {
+        update_git_diff(self);
+      } else {
+        start_git_diff(self);
+      }
+    }
+    return G_SOURCE_REMOVE;
   }, self);
 }
+
+static void git_head_ready(GObject *source_object, GAsyncResult *result, gpointer user_data) {
+  GBytes *stdout_bytes = NULL;
+  GError *error = NULL;
+  if (!g_subprocess_communicate_finish(G_SUBPROCESS(source_object), result, &stdout_bytes, NULL, &error)) {
+    // the widget might already be gone if the read was cancelled
+    g_error_free(error);
+    return;
+  }
+  AtomTextEditorWidget *self = ATOM_TEXT_EDITOR_WIDGET(user_data);
+  GitState *git = GET_PRIVATE(self)->git;
+  if (g_subprocess_get_successful(G_SUBPROCESS(source_object)) && stdout_bytes) {
+    gsize size;
+    const gchar *data = (const gchar *)g_bytes_get_data(stdout_bytes, &size);
+    gchar *valid = g_utf8_make_valid(data ? data : "", size);
+    glong length = 0;
+    gunichar2 *utf16 = g_utf8_to_utf16(valid, -1, NULL, &length, NULL);
+    git->head_lines = std::make_shared<const std::vector<std::u16string>>(split_lines(std::u16string((const char16_t *)utf16, length)));
+    g_free(utf16);
+    g_free(valid);
+    start_git_diff(self);
+  } else {
+    // the file is not tracked
+    if (git->diff_cancellable) {
+      g_cancellable_cancel(git->diff_cancellable);
+      g_object_unref(git->diff_cancellable);
+      git->diff_cancellable = NULL;
+    }
+    git->head_lines = nullptr;
+    git->diff.invalidate();
+    for (int status = 0; status < GIT_LINE_STATUS_COUNT; status++) {
+      git->marker_layers[status]->clear();
+    }
+    gtk_widget_queue_draw(GTK_WIDGET(self));
+  }
+  if (stdout_bytes) {
+    g_bytes_unref(stdout_bytes);
+  }
+}
+
+static void load_git_head(AtomTextEditorWidget *self) {
+  AtomTextEditorWidgetPrivate *priv = GET_PRIVATE(self);
+  GitState *git = priv->git;
+  optional<std::string> path = priv->text_editor->getPath();
+  if (!path) return;
+  if (git->head_cancellable) {
+    g_cancellable_cancel(git->head_cancellable);
+    g_object_unref(git->head_cancellable);
+  }
+  git->head_cancellable = g_cancellable_new();
+  gchar *directory = g_path_get_dirname(path->c_str());
+  gchar *basename = g_path_get_basename(path->c_str());
+  // git reads the blob from the local object store, including packed objects
+  gchar *object = g_strconcat("HEAD:./", basename, NULL);
+  const gchar *argv[] = {"git", "-C", directory, "show", object, NULL};
+  GSubprocess *subprocess = g_subprocess_newv(argv, (GSubprocessFlags)(G_SUBPROCESS_FLAGS_STDOUT_PIPE | G_SUBPROCESS_FLAGS_STDERR_SILENCE), NULL);
+  if (subprocess) {
+    g_subprocess_communicate_async(subprocess, NULL, git->head_cancellable, git_head_ready, self);
+    g_object_unref(subprocess);
+  }
+  g_free(object);
+  g_free(basename);
+  g_free(directory);
+}
@@ -45,6 +45,7 @@ struct _AtomTextEditorWidgetClass {
   void (*add_selection_above)(AtomTextEditorWidget *);
   void (*add_selection_below)(AtomTextEditorWidget *);
   void (*select_next)(AtomTextEditorWidget *);
+  void (*select_all_occurrences)(AtomTextEditorWidget *);
   void (*insert_newline)(AtomTextEditorWidget *);
   void (*insert_newline_above)(AtomTextEditorWidget *);
   void (*insert_newline_below)(AtomTextEditorWidget *);
@@ -65,15 +66,38 @@ struct _AtomTextEditorWidgetClass {
   void (*copy)(AtomTextEditorWidget *);
   void (*cut)(AtomTextEditorWidget *);
   void (*paste)(AtomTextEditorWidget *);
+  void (*find_next)(AtomTextEditorWidget *);
+  void (*find_previous)(AtomTextEditorWidget *);
 };
 
 AtomTextEditorWidget *atom_text_editor_widget_new(GFile *);
+void atom_text_editor_widget_warm_up(void);
+gchar **atom_text_editor_widget_get_recoverable_files(void);
 gchar *atom_text_editor_widget_get_title(AtomTextEditorWidget *);
 gboolean atom_text_editor_widget_get_modified(AtomTextEditorWidget *);
 gchar *atom_text_editor_widget_get_path(AtomTextEditorWidget *);
+GFile *atom_text_editor_widget_get_file(AtomTextEditorWidget *);
 gchar *atom_text_editor_widget_get_cursor_position(AtomTextEditorWidget *);
+void atom_text_editor_widget_set_cursor_buffer_position(AtomTextEditorWidget *, gdouble, gdouble);
+gdouble *atom_text_editor_widget_get_selected_ranges(AtomTextEditorWidget *, gint *);
+void atom_text_editor_widget_set_selected_ranges(AtomTextEditorWidget *, const gdouble *, gint);
+gdouble atom_text_editor_widget_get_scroll_row(AtomTextEditorWidget *);
+void atom_text_editor_widget_set_scroll_row(AtomTextEditorWidget *, gdouble);
 gchar *atom_text_editor_widget_get_selection_count(AtomTextEditorWidget *);
 const gchar *atom_text_editor_widget_get_grammar(AtomTextEditorWidget *);
+gdouble atom_text_editor_widget_get_progress(AtomTextEditorWidget *);
+gint atom_text_editor_widget_get_match_count(AtomTextEditorWidget *);
+gboolean atom_text_editor_widget_find(AtomTextEditorWidget *, const gchar *, gboolean, gboolean);
+void atom_text_editor_widget_find_next(AtomTextEditorWidget *);
+void atom_text_editor_widget_find_previous(AtomTextEditorWidget *);
+gboolean atom_text_editor_widget_replace_next(AtomTextEditorWidget *, const gchar *);
+gboolean atom_text_editor_widget_replace_all(AtomTextEditorWidget *, const gchar *);
+gboolean atom_text_editor_widget_get_degraded(AtomTextEditorWidget *);
+void atom_text_editor_widget_set_highlighting(AtomTextEditorWidget *, gboolean);
+void atom_text_editor_widget_set_bracket_matching(AtomTextEditorWidget *, gboolean);
+void atom_text_editor_widget_set_whitespace_handling(AtomTextEditorWidget *, gboolean);
+void atom_text_editor_widget_set_token_styling(AtomTextEditorWidget *, gboolean);
+void atom_text_editor_widget_set_soft_wrapped(AtomTextEditorWidget *, gboolean);
 gboolean atom_text_editor_widget_save(AtomTextEditorWidget *);
 void atom_text_editor_widget_save_as(AtomTextEditorWidget *, GFile *);
 
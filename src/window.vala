@@ -1,7 +1,16 @@
 namespace Atom {
 
 class Window : Gtk.ApplicationWindow {
+  // opening, closing and switching tabs is saved once this many milliseconds have passed without another change
+  private const uint SAVE_SESSION_DELAY = 1000;
+
   private Gtk.FileChooserNative dialog;
+  private Atom.Notebook notebook;
+  private Atom.FindInFilesPanel find_in_files_panel;
+  private Atom.FuzzyFinder? fuzzy_finder;
+  private Atom.Session session = new Atom.Session();
+  private uint save_session_source_id = 0;
+  private bool closing = false;
 
   public Window(Gtk.Application application) {
     Object(application: application);
@@ -21,6 +30,18 @@ class Window : Gtk.ApplicationWindow {
     var save_all_action = new SimpleAction("save-all", null);
     save_all_action.activate.connect(save_all);
     add_action(save_all_action);
+    var find_action = new SimpleAction("find", null);
+    find_action.activate.connect(find);
+    add_action(find_action);
+    var find_in_files_action = new SimpleAction("find-in-files", null);
+    find_in_files_action.activate.connect(find_in_files);
+    add_action(find_in_files_action);
+    var fuzzy_finder_action = new SimpleAction("fuzzy-finder", null);
+    fuzzy_finder_action.activate.connect(show_fuzzy_finder);
+    add_action(fuzzy_finder_action);
+    var soft_wrap_action = new SimpleAction("toggle-soft-wrap", null);
+    soft_wrap_action.activate.connect(toggle_soft_wrap);
+    add_action(soft_wrap_action);
 
     var header_bar = new Gtk.HeaderBar();
     header_bar.show_close_button = true;
@@ -52,12 +73,83 @@ class Window : Gtk.ApplicationWindow {
     set_titlebar(header_bar);
 
     set_default_size(750, 500);
-    var notebook = new Atom.Notebook();
-    add(notebook);
+    var paned = new Gtk.Paned(Gtk.Orientation.VERTICAL);
+    notebook = new Atom.Notebook();
+    notebook.page_added.connect(() => schedule_save_session());
+    notebook.page_removed.connect(() => schedule_save_session());
+    notebook.page_reordered.connect(() => schedule_save_session());
+    notebook.switch_page.connect(() => schedule_save_session());
+    paned.pack1(notebook, true, false);
+    find_in_files_panel = new Atom.FindInFilesPanel();
+    find_in_files_panel.result_activated.connect((file, row, column) => {
+      append_tab(file, row, column);
+    });
+    find_in_files_panel.show_all();
+    find_in_files_panel.no_show_all = true;
+    find_in_files_panel.hide();
+    paned.pack2(find_in_files_panel, false, false);
+    add(paned);
+  }
+
+  public void append_tab(File? file = null, int row = 0, int column = 0) {
+    get_notebook().append_tab(file, row, column);
+  }
+
+  public bool restore_session() {
+    return session.restore(get_notebook());
+  }
+
+  // opens the files that have unsaved changes from before a crash, returns false if there were none
+  public bool recover_files(string[] paths) {
+    bool recovered = false;
+    foreach (unowned string path in paths) {
+      var file = File.new_for_path(path);
+      if (!get_notebook().has_file(file)) {
+        append_tab(file);
+        recovered = true;
+      }
+    }
+    return recovered;
+  }
+
+  public void save_session() {
+    // the saved session still has the tabs that have not been restored yet
+    if (closing || session.restoring) {
+      return;
+    }
+    Atom.Session.save(get_notebook());
   }
 
-  public void append_tab(File? file = null) {
-    get_notebook().append_tab(file);
+  private void schedule_save_session() {
+    if (closing || session.restoring || save_session_source_id != 0) {
+      return;
+    }
+    save_session_source_id = Timeout.add(SAVE_SESSION_DELAY, () => {
+      save_session_source_id = 0;
+      save_session();
+      return Source.REMOVE;
+    });
+  }
+
+  // the tabs are removed while the window is destroyed, which must not be saved
+  private void stop_session() {
+    session.cancel_restore();
+    if (save_session_source_id != 0) {
+      Source.remove(save_session_source_id);
+      save_session_source_id = 0;
+    }
+    closing = true;
+  }
+
+  public override bool delete_event(Gdk.EventAny event) {
+    save_session();
+    stop_session();
+    return base.delete_event(event);
+  }
+
+  public override void destroy() {
+    stop_session();
+    base.destroy();
   }
 
   private Gtk.Widget linked(Gtk.Widget first, Gtk.Widget second, Gtk.Orientation orientation = Gtk.Orientation.HORIZONTAL) {
@@ -108,8 +200,31 @@ class Window : Gtk.ApplicationWindow {
     get_notebook().save_all();
   }
 
+  private void find() {
+    get_notebook().find();
+  }
+
+  private void toggle_soft_wrap() {
+    get_notebook().toggle_soft_wrap();
+  }
+
+  private void find_in_files() {
+    find_in_files_panel.show_panel();
+  }
+
+  private void show_fuzzy_finder() {
+    if (fuzzy_finder == null) {
+      // the path index is built on first use and kept up to date from then on
+      fuzzy_finder = new Atom.FuzzyFinder(this, File.new_for_path(Environment.get_current_dir()));
+      fuzzy_finder.file_selected.connect((file) => {
+        append_tab(file);
+      });
+    }
+    fuzzy_finder.show_finder();
+  }
+
   private unowned Atom.Notebook get_notebook() {
-    return get_child() as unowned Atom.Notebook;
+    return notebook;
   }
 }
 
@@ -0,0 +1,147 @@
+#include "bracket-index.h"
+#include <algorithm>
+#include <glib.h>
+#include <map>
+#include <string>
+
+static std::vector<std::u16string> split_lines(const std::u16string &text) {
+  std::vector<std::u16string> lines;
+  size_t start = 0;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == u'\n') {
+      lines.emplace_back(text, start, i - start);
+      start = i + 1;
+    }
+  }
+  lines.emplace_back(text, start, text.size() - start);
+  return lines;
+}
+
+// brackets between quotes stand in for the ones the syntax tree puts in strings
+static std::vector<Bracket> tokenize(const std::u16string &line) {
+  std::vector<Bracket> brackets;
+  bool in_string = false;
+  for (size_t column = 0; column < line.size(); column++) {
+    const char16_t c = line[column];
+    if (c == u'"') {
+      in_string = !in_string;
+    } else if (!in_string && std::u16string(u"()[]{}").find(c) != std::u16string::npos) {
+      brackets.push_back({(uint32_t)column, c});
+    }
+  }
+  return brackets;
+}
+
+static void set_rows(BracketIndex &index, const std::vector<std::u16string> &lines, size_t first, size_t last) {
+  for (size_t row = first; row <= last; row++) {
+    index.set_row(row, tokenize(lines[row]), false);
+  }
+}
+
+// every kind of bracket matched on its own with a stack, as the index should
+static void assert_partners(BracketIndex &index, const std::vector<std::u16string> &lines) {
+  g_assert_cmpuint(index.get_row_count(), ==, lines.size());
+  std::vector<Point> stacks[3];
+  std::map<std::pair<double, double>, Point> partners;
+  std::vector<Point> brackets;
+  for (size_t row = 0; row < lines.size(); row++) {
+    for (const Bracket &bracket : tokenize(lines[row])) {
+      const Point position(row, bracket.column);
+      brackets.push_back(position);
+      const size_t kind = std::u16string(u"([{)]}").find(bracket.character);
+      if (kind < 3) {
+        stacks[kind].push_back(position);
+      } else if (!stacks[kind - 3].empty()) {
+        const Point &opening = stacks[kind - 3].back();
+        partners[{opening.row, opening.column}] = position;
+        partners[{position.row, position.column}] = opening;
+        stacks[kind - 3].pop_back();
+      }
+    }
+  }
+  size_t matched = 0;
+  for (const Point &position : brackets) {
+    Point partner;
+    if (!index.find_partner(position, partner)) continue;
+    matched++;
+    const auto expected = partners.find({position.row, position.column});
+    g_assert_true(expected != partners.end() && expected->second == partner);
+  }
+  g_assert_cmpuint(matched, ==, partners.size());
+}
+
+static void test_find_partner() {
+  const std::vector<std::u16string> lines = split_lines(u"f(a[0], \")\") {\n  (x]\n}\n)");
+  BracketIndex index;
+  index.splice(0, 0, lines.size());
+  set_rows(index, lines, 0, lines.size() - 1);
+  Point partner;
+  g_assert_true(index.find_partner(Point(0, 1), partner));
+  g_assert_true(partner == Point(0, 11));
+  g_assert_true(index.find_partner(Point(0, 13), partner));
+  g_assert_true(partner == Point(2, 0));
+  g_assert_true(index.find_partner(Point(3, 0), partner));
+  g_assert_true(partner == Point(1, 2));
+  // the bracket in the string and the one without a partner
+  g_assert_false(index.find_partner(Point(0, 9), partner));
+  g_assert_false(index.find_partner(Point(1, 4), partner));
+  assert_partners(index, lines);
+}
+
+static void test_partner_in_distant_block() {
+  std::u16string text = u"{";
+  for (int i = 0; i < 5000; i++) {
+    text += i % 2 ? u"\n(a)" : u"\nb";
+  }
+  text += u"\n}";
+  const std::vector<std::u16string> lines = split_lines(text);
+  BracketIndex index;
+  index.splice(0, 0, lines.size());
+  set_rows(index, lines, 0, lines.size() - 1);
+  Point partner;
+  g_assert_true(index.find_partner(Point(0, 0), partner));
+  g_assert_true(partner == Point(lines.size() - 1, 0));
+  g_assert_true(index.find_partner(partner, partner));
+  g_assert_true(partner == Point(0, 0));
+}
+
+static void test_random_edits() {
+  static const char16_t *pieces[] = {u"(", u")", u"[", u"]", u"{", u"}", u"\"", u"a", u"\n", u"\n"};
+  GRand *rand = g_rand_new_with_seed(42);
+  auto random_text = [&](int length) {
+    std::u16string text;
+    for (int i = 0; i < length; i++) {
+      text.append(pieces[g_rand_int_range(rand, 0, G_N_ELEMENTS(pieces))]);
+    }
+    return text;
+  };
+  for (int iteration = 0; iteration < 200; iteration++) {
+    std::u16string text = random_text(3000);
+    std::vector<std::u16string> lines = split_lines(text);
+    BracketIndex index;
+    index.splice(0, 0, lines.size());
+    set_rows(index, lines, 0, lines.size() - 1);
+    for (int round = 0; round < 5; round++) {
+      const size_t start = g_rand_int_range(rand, 0, text.size() + 1);
+      const size_t end = start + g_rand_int_range(rand, 0, std::min<size_t>(text.size() - start, 2000) + 1);
+      const std::u16string new_text = random_text(g_rand_int_range(rand, 0, 2000));
+      const size_t first_row = std::count(text.begin(), text.begin() + start, u'\n');
+      const size_t old_rows = std::count(text.begin() + start, text.begin() + end, u'\n') + 1;
+      const size_t new_rows = std::count(new_text.begin(), new_text.end(), u'\n') + 1;
+      text.replace(start, end - start, new_text);
+      lines = split_lines(text);
+      index.splice(first_row, old_rows, new_rows);
+      set_rows(index, lines, first_row, first_row + new_rows - 1);
+      assert_partners(index, lines);
+    }
+  }
+  g_rand_free(rand);
+}
+
+int main(int argc, char **argv) {
+  g_test_init(&argc, &argv, NULL);
+  g_test_add_func("/bracket-index/find-partner", test_find_partner);
+  g_test_add_func("/bracket-index/partner-in-distant-block", test_partner_in_distant_block);
+  g_test_add_func("/bracket-index/random-edits", test_random_edits);
+  return g_test_run();
+}
@@ -0,0 +1,108 @@
+#include "buffer-search.h"
+#include <glib.h>
+
+static std::vector<Range> search(const BufferSearch &buffer_search, const std::u16string &text) {
+  std::vector<Range> matches;
+  buffer_search.search(text, NULL, [&](std::vector<Range> &&batch) {
+    matches.insert(matches.end(), batch.begin(), batch.end());
+  });
+  return matches;
+}
+
+static void test_search() {
+  BufferSearch buffer_search(u"b+", true, true);
+  g_assert_true(buffer_search.is_valid());
+  const std::vector<Range> matches = search(buffer_search, u"abba\nbab");
+  g_assert_cmpuint(matches.size(), ==, 3);
+  g_assert_cmpfloat(matches[0].start.row, ==, 0);
+  g_assert_cmpfloat(matches[0].start.column, ==, 1);
+  g_assert_cmpfloat(matches[0].end.column, ==, 3);
+  g_assert_cmpfloat(matches[1].start.row, ==, 1);
+  g_assert_cmpfloat(matches[1].start.column, ==, 0);
+  g_assert_cmpfloat(matches[2].start.row, ==, 1);
+  g_assert_cmpfloat(matches[2].start.column, ==, 2);
+}
+
+static void test_search_batches() {
+  BufferSearch buffer_search(u"x", false, true);
+  std::u16string text(2500, u'x');
+  size_t batches = 0;
+  size_t count = 0;
+  buffer_search.search(text, NULL, [&](std::vector<Range> &&batch) {
+    batches++;
+    count += batch.size();
+  });
+  g_assert_cmpuint(batches, ==, 3);
+  g_assert_cmpuint(count, ==, 2500);
+}
+
+static void test_invalid_pattern() {
+  BufferSearch buffer_search(u"(", true, true);
+  g_assert_false(buffer_search.is_valid());
+  std::u16string output;
+  g_assert_false(buffer_search.substitute(u"(", 0, 1, u"x", output));
+}
+
+static void test_substitute_groups() {
+  BufferSearch buffer_search(u"(\\w+)=(\\w+)", true, true);
+  const std::u16string text = u"a=1, b=2";
+  std::u16string output;
+  g_assert_true(buffer_search.substitute(text, 5, 8, u"$2=$1", output));
+  g_assert_true(output == u"2=b");
+}
+
+// lookarounds and anchors have to see the text around the match
+static void test_substitute_context() {
+  BufferSearch lookbehind(u"(?<=foo)bar", true, true);
+  const std::u16string text = u"foobar bar";
+  g_assert_cmpuint(search(lookbehind, text).size(), ==, 1);
+  std::u16string output;
+  g_assert_true(lookbehind.substitute(text, 3, 6, u"[$0]", output));
+  g_assert_true(output == u"[bar]");
+  g_assert_false(lookbehind.substitute(text, 7, 10, u"[$0]", output));
+
+  BufferSearch anchor(u"^b", true, true);
+  g_assert_false(anchor.substitute(u"ab\nb", 1, 2, u"c", output));
+  g_assert_true(anchor.substitute(u"ab\nb", 3, 4, u"c", output));
+  g_assert_true(output == u"c");
+}
+
+// a window that is cut out of a line does not start or end where the line does
+static void test_substitute_window() {
+  BufferSearch anchors(u"^b|b$", true, true);
+  std::u16string output;
+  g_assert_false(anchors.substitute(u"bab", 0, 1, u"c", output, false, false));
+  g_assert_false(anchors.substitute(u"bab", 2, 3, u"c", output, false, false));
+  g_assert_true(anchors.substitute(u"\nbab", 1, 2, u"c", output, false, false));
+  g_assert_true(anchors.substitute(u"bab", 2, 3, u"c", output, false, true));
+}
+
+static void test_substitute_failure() {
+  BufferSearch buffer_search(u"a(b)", true, true);
+  std::u16string output;
+  // the match is no longer at the given offsets
+  g_assert_false(buffer_search.substitute(u"xab", 0, 2, u"$1", output));
+  g_assert_false(buffer_search.substitute(u"ab", 0, 1, u"$1", output));
+  // a reference to a group that does not exist is not inserted literally
+  g_assert_false(buffer_search.substitute(u"ab", 0, 2, u"$2", output));
+}
+
+static void test_substitute_literal() {
+  BufferSearch buffer_search(u"a.b", false, false);
+  std::u16string output;
+  g_assert_true(buffer_search.substitute(u"A.B", 0, 3, u"$1", output));
+  g_assert_true(output == u"$1");
+}
+
+int main(int argc, char **argv) {
+  g_test_init(&argc, &argv, NULL);
+  g_test_add_func("/buffer-search/search", test_search);
+  g_test_add_func("/buffer-search/search-batches", test_search_batches);
+  g_test_add_func("/buffer-search/invalid-pattern", test_invalid_pattern);
+  g_test_add_func("/buffer-search/substitute-groups", test_substitute_groups);
+  g_test_add_func("/buffer-search/substitute-context", test_substitute_context);
+  g_test_add_func("/buffer-search/substitute-window", test_substitute_window);
+  g_test_add_func("/buffer-search/substitute-failure", test_substitute_failure);
+  g_test_add_func("/buffer-search/substitute-literal", test_substitute_literal);
+  return g_test_run();
+}
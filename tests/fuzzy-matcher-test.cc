@@ -0,0 +1,96 @@
+#include "fuzzy-matcher.h"
+#include <string>
+#include <vector>
+
+static std::vector<std::string> match(AtomFuzzyMatcher *matcher, const char *query, gint max_results) {
+  gchar **results = atom_fuzzy_matcher_match(matcher, query, max_results);
+  std::vector<std::string> paths;
+  for (gchar **result = results; *result; result++) {
+    paths.push_back(*result);
+  }
+  g_strfreev(results);
+  return paths;
+}
+
+static AtomFuzzyMatcher *create_matcher() {
+  AtomFuzzyMatcher *matcher = atom_fuzzy_matcher_new();
+  const gchar *paths[] = {"main/src.c", "src/main.c", "src/mainly.c", "README.md"};
+  atom_fuzzy_matcher_set_paths(matcher, paths, G_N_ELEMENTS(paths));
+  return matcher;
+}
+
+static void test_empty_query() {
+  AtomFuzzyMatcher *matcher = create_matcher();
+  g_assert_cmpint(atom_fuzzy_matcher_get_path_count(matcher), ==, 4);
+  const std::vector<std::string> paths = match(matcher, "", 2);
+  g_assert_cmpuint(paths.size(), ==, 2);
+  g_assert_cmpstr(paths[0].c_str(), ==, "README.md");
+  g_assert_cmpstr(paths[1].c_str(), ==, "main/src.c");
+  g_object_unref(matcher);
+}
+
+static void test_ranking() {
+  AtomFuzzyMatcher *matcher = create_matcher();
+  const std::vector<std::string> paths = match(matcher, "MAIN", 10);
+  g_assert_cmpuint(paths.size(), ==, 3);
+  // matches in the file name come first, then shorter paths
+  g_assert_cmpstr(paths[0].c_str(), ==, "src/main.c");
+  g_assert_cmpstr(paths[1].c_str(), ==, "src/mainly.c");
+  g_assert_cmpstr(paths[2].c_str(), ==, "main/src.c");
+  g_assert_cmpuint(match(matcher, "rdm", 10).size(), ==, 1);
+  g_assert_cmpuint(match(matcher, "xyz", 10).size(), ==, 0);
+  g_object_unref(matcher);
+}
+
+// the candidates of a previous query must not hide paths that were added or removed since
+static void test_refine_after_changes() {
+  AtomFuzzyMatcher *matcher = create_matcher();
+  g_assert_cmpuint(match(matcher, "ma", 10).size(), ==, 3);
+  atom_fuzzy_matcher_add_path(matcher, "docs/manual.md");
+  g_assert_cmpuint(match(matcher, "man", 10).size(), ==, 4);
+  atom_fuzzy_matcher_add_path(matcher, "docs/manual.md");
+  g_assert_cmpint(atom_fuzzy_matcher_get_path_count(matcher), ==, 5);
+  atom_fuzzy_matcher_remove_path(matcher, "src/main.c");
+  const std::vector<std::string> paths = match(matcher, "man", 10);
+  g_assert_cmpuint(paths.size(), ==, 3);
+  for (const std::string &path : paths) {
+    g_assert_cmpstr(path.c_str(), !=, "src/main.c");
+  }
+  g_object_unref(matcher);
+}
+
+static void test_remove_directory() {
+  AtomFuzzyMatcher *matcher = create_matcher();
+  atom_fuzzy_matcher_remove_path(matcher, "src");
+  g_assert_cmpint(atom_fuzzy_matcher_get_path_count(matcher), ==, 2);
+  // only whole path components are removed
+  atom_fuzzy_matcher_remove_path(matcher, "mai");
+  g_assert_cmpint(atom_fuzzy_matcher_get_path_count(matcher), ==, 2);
+  const std::vector<std::string> paths = match(matcher, "c", 10);
+  g_assert_cmpuint(paths.size(), ==, 1);
+  g_assert_cmpstr(paths[0].c_str(), ==, "main/src.c");
+  g_object_unref(matcher);
+}
+
+static void test_parallel_match() {
+  AtomFuzzyMatcher *matcher = atom_fuzzy_matcher_new();
+  // enough paths to be split across threads
+  for (int i = 0; i < 100000; i++) {
+    gchar *path = g_strdup_printf("directory-%d/file-%d.txt", i % 100, i);
+    atom_fuzzy_matcher_add_path(matcher, path);
+    g_free(path);
+  }
+  g_assert_cmpuint(match(matcher, "file-99999", 10).size(), ==, 1);
+  g_assert_cmpuint(match(matcher, "d99/f", 1000000).size(), ==, 1000);
+  g_object_unref(matcher);
+}
+
+int main(int argc, char **argv) {
+  g_test_init(&argc, &argv, NULL);
+  g_test_add_func("/fuzzy-matcher/empty-query", test_empty_query);
+  g_test_add_func("/fuzzy-matcher/ranking", test_ranking);
+  g_test_add_func("/fuzzy-matcher/refine-after-changes", test_refine_after_changes);
+  g_test_add_func("/fuzzy-matcher/remove-directory", test_remove_directory);
+  g_test_add_func("/fuzzy-matcher/parallel-match", test_parallel_match);
+  return g_test_run();
+}
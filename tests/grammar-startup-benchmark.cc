@@ -0,0 +1,21 @@
+#include "lazy-grammars.h"
+#include <chrono>
+#include <cstdio>
+
+// the cost of creating the built-in grammars, which class_init used to pay for all of
+// them before the first window appeared and which is now only paid per grammar a file needs
+int main() {
+  GrammarRegistry registry;
+  double total = 0;
+  for (size_t i = 0; i < lazy_grammar_count; i++) {
+    const auto start = std::chrono::steady_clock::now();
+    TreeSitterGrammar *grammar = lazy_grammars[i].create();
+    registry.addGrammar(grammar);
+    const auto end = std::chrono::steady_clock::now();
+    const double duration = std::chrono::duration<double, std::milli>(end - start).count();
+    total += duration;
+    std::printf("%-12s %8.3f ms\n", grammar->name, duration);
+  }
+  std::printf("%-12s %8.3f ms\n", "all", total);
+  return 0;
+}
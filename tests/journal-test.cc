@@ -0,0 +1,102 @@
+#include "journal.h"
+#include <glib.h>
+
+static TextBuffer *create_buffer(const std::u16string &text) {
+  TextBuffer *buffer = new TextBuffer();
+  buffer->setText(text);
+  return buffer;
+}
+
+static Range get_range(TextBuffer *buffer) {
+  const double last_row = buffer->getLastRow();
+  return Range(Point(0, 0), Point(last_row, buffer->lineLengthForRow(last_row)));
+}
+
+static void test_parse() {
+  const JournalHeader header = {"/tmp/file.txt", 1234567890123456789, 42, 40};
+  std::string data;
+  append_journal_header(data, header);
+  append_journal_record(data, Range(Point(0, 1), Point(2, 3)), u"abc");
+  append_journal_record(data, Range(Point(4, 0), Point(4, 0)), u"");
+  JournalHeader parsed;
+  std::vector<JournalRecord> records;
+  g_assert_true(parse_journal(data.data(), data.size(), parsed, records));
+  g_assert_cmpstr(parsed.file_path.c_str(), ==, "/tmp/file.txt");
+  g_assert_cmpint(parsed.base_mtime, ==, header.base_mtime);
+  g_assert_cmpint(parsed.base_size, ==, 42);
+  g_assert_cmpuint(parsed.base_length, ==, 40);
+  g_assert_cmpuint(records.size(), ==, 2);
+  g_assert_cmpfloat(records[0].old_range.end.row, ==, 2);
+  g_assert_true(records[0].text == u"abc");
+  // a record cut short by a crash is dropped
+  g_assert_true(parse_journal(data.data(), data.size() - 1, parsed, records));
+  g_assert_cmpuint(records.size(), ==, 1);
+  // a journal of another version is not replayed
+  data[4]++;
+  g_assert_false(parse_journal(data.data(), data.size(), parsed, records));
+}
+
+// the edits recorded on one buffer bring a copy of the original text to the same state
+static void test_replay() {
+  const std::u16string base = u"first line\nsecond line\n\nfourth line";
+  GRand *rand = g_rand_new_with_seed(42);
+  for (int iteration = 0; iteration < 200; iteration++) {
+    TextBuffer *buffer = create_buffer(base);
+    std::string data;
+    append_journal_header(data, {"/tmp/file.txt", 0, 0, base.size()});
+    for (int i = 0; i < 20; i++) {
+      const std::u16string text = buffer->getText();
+      const size_t start = g_rand_int_range(rand, 0, text.size() + 1);
+      const size_t end = start + g_rand_int_range(rand, 0, std::min<size_t>(text.size() - start, 8) + 1);
+      const std::u16string inserted = g_rand_boolean(rand) ? u"x\ny" : u"z";
+      Point start_position(0, 0);
+      for (size_t j = 0; j < start; j++) {
+        start_position = text[j] == u'\n' ? Point(start_position.row + 1, 0) : Point(start_position.row, start_position.column + 1);
+      }
+      Point end_position = start_position;
+      for (size_t j = start; j < end; j++) {
+        end_position = text[j] == u'\n' ? Point(end_position.row + 1, 0) : Point(end_position.row, end_position.column + 1);
+      }
+      const Range old_range(start_position, end_position);
+      buffer->setTextInRange(old_range, inserted);
+      append_journal_record(data, old_range, inserted);
+    }
+    JournalHeader header;
+    std::vector<JournalRecord> records;
+    g_assert_true(parse_journal(data.data(), data.size(), header, records));
+    TextBuffer *copy = create_buffer(base);
+    g_assert_true(replay_journal(copy, records));
+    g_assert_true(copy->getText() == buffer->getText());
+    delete copy;
+    delete buffer;
+  }
+  g_rand_free(rand);
+}
+
+// a compacted journal replaces the whole text with a single record
+static void test_replay_compacted() {
+  TextBuffer *buffer = create_buffer(u"old\ntext");
+  std::vector<JournalRecord> records = {{get_range(buffer), u"new\ntext\n"}, {Range(Point(2, 0), Point(2, 0)), u"!"}};
+  g_assert_true(replay_journal(buffer, records));
+  g_assert_true(buffer->getText() == u"new\ntext\n!");
+  delete buffer;
+}
+
+static void test_replay_misfit() {
+  TextBuffer *buffer = create_buffer(u"short");
+  std::vector<JournalRecord> records = {{Range(Point(0, 0), Point(0, 1)), u"S"}, {Range(Point(0, 2), Point(0, 9)), u""}};
+  g_assert_false(replay_journal(buffer, records));
+  g_assert_true(buffer->getText() == u"Short");
+  records = {{Range(Point(0, 3), Point(0, 1)), u""}};
+  g_assert_false(replay_journal(buffer, records));
+  delete buffer;
+}
+
+int main(int argc, char **argv) {
+  g_test_init(&argc, &argv, NULL);
+  g_test_add_func("/journal/parse", test_parse);
+  g_test_add_func("/journal/replay", test_replay);
+  g_test_add_func("/journal/replay-compacted", test_replay_compacted);
+  g_test_add_func("/journal/replay-misfit", test_replay_misfit);
+  return g_test_run();
+}
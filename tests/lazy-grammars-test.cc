@@ -0,0 +1,53 @@
+#include "lazy-grammars.h"
+#include <algorithm>
+
+static std::vector<std::string> sorted(std::vector<std::string> file_types) {
+  std::sort(file_types.begin(), file_types.end());
+  return file_types;
+}
+
+// the table decides which grammar gets created, the grammar itself decides which files it is selected for
+static void test_file_types() {
+  GrammarRegistry registry;
+  for (size_t i = 0; i < lazy_grammar_count; i++) {
+    TreeSitterGrammar *grammar = lazy_grammars[i].create();
+    registry.addGrammar(grammar);
+    const std::vector<std::string> expected = sorted(grammar->fileTypes);
+    const std::vector<std::string> actual = sorted(lazy_grammars[i].file_types);
+    if (expected != actual) {
+      g_test_message("the file types of %s differ from the table", grammar->name);
+      g_test_fail();
+    }
+  }
+}
+
+static bool matches(size_t index, const char *basename, const char *extension, const char *first_line) {
+  return lazy_grammar_matches(lazy_grammars[index], basename, extension, first_line);
+}
+
+static void test_matches() {
+  // c, cpp, ..., javascript, json, python, rust
+  const size_t c = 0;
+  const size_t cpp = 1;
+  const size_t javascript = 5;
+  const size_t python = 7;
+  g_assert_true(matches(c, "main.c", "c", ""));
+  g_assert_true(matches(c, "main.h", "h", ""));
+  g_assert_true(matches(cpp, "main.h", "h", ""));
+  g_assert_false(matches(c, "main.cc", "cc", ""));
+  g_assert_true(matches(python, "SConstruct", "", ""));
+  g_assert_true(matches(python, "script", "", "#!/usr/bin/env python3.12"));
+  g_assert_true(matches(javascript, "script", "", "#!/usr/bin/env node"));
+  g_assert_false(matches(javascript, "script", "", "#!/bin/sh"));
+  g_assert_false(matches(javascript, "script", "", NULL));
+  for (size_t i = 0; i < lazy_grammar_count; i++) {
+    g_assert_false(matches(i, "notes.txt", "txt", "plain text"));
+  }
+}
+
+int main(int argc, char **argv) {
+  g_test_init(&argc, &argv, NULL);
+  g_test_add_func("/lazy-grammars/file-types", test_file_types);
+  g_test_add_func("/lazy-grammars/matches", test_matches);
+  return g_test_run();
+}
@@ -0,0 +1,149 @@
+#include "line-diff.h"
+#include <glib.h>
+
+static std::vector<std::u16string> split_lines(const std::u16string &text) {
+  std::vector<std::u16string> lines;
+  size_t start = 0;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == u'\n') {
+      lines.emplace_back(text, start, i - start);
+      start = i + 1;
+    }
+  }
+  lines.emplace_back(text, start, text.size() - start);
+  return lines;
+}
+
+static Point position_for_index(const std::u16string &text, size_t index) {
+  Point position(0, 0);
+  for (size_t i = 0; i < index; i++) {
+    if (text[i] == u'\n') {
+      position = Point(position.row + 1, 0);
+    } else {
+      position.column++;
+    }
+  }
+  return position;
+}
+
+// replaces the text between start and end and returns the change as the buffer would report it
+static BufferChange edit(std::u16string &text, size_t start, size_t end, const std::u16string &new_text) {
+  const Range old_range(position_for_index(text, start), position_for_index(text, end));
+  text.replace(start, end - start, new_text);
+  return BufferChange{old_range, Range(old_range.start, position_for_index(text, start + new_text.size()))};
+}
+
+// the lines between the hunks have to be equal and the hunks have to account for every other line
+static void assert_valid(const std::vector<std::u16string> &old_lines, const std::vector<std::u16string> &new_lines, const std::vector<LineHunk> &hunks) {
+  size_t old_row = 0;
+  size_t new_row = 0;
+  for (const LineHunk &hunk : hunks) {
+    g_assert_false(hunk.dirty);
+    g_assert_true(hunk.old_count > 0 || hunk.new_count > 0);
+    g_assert_cmpuint(hunk.old_start, >=, old_row);
+    g_assert_cmpuint(hunk.old_start - old_row, ==, hunk.new_start - new_row);
+    for (; old_row < hunk.old_start; old_row++, new_row++) {
+      g_assert_true(old_lines[old_row] == new_lines[new_row]);
+    }
+    old_row += hunk.old_count;
+    new_row += hunk.new_count;
+  }
+  g_assert_cmpuint(old_lines.size() - old_row, ==, new_lines.size() - new_row);
+  for (; old_row < old_lines.size(); old_row++, new_row++) {
+    g_assert_true(old_lines[old_row] == new_lines[new_row]);
+  }
+}
+
+static void test_diff_lines() {
+  const std::vector<std::u16string> old_lines = split_lines(u"a\nb\nc\nd\ne");
+  const std::vector<std::u16string> new_lines = split_lines(u"a\nB\nc\nx\ny\ne\nf");
+  const std::vector<LineHunk> hunks = diff_lines(old_lines.data(), old_lines.size(), new_lines.data(), new_lines.size());
+  g_assert_cmpuint(hunks.size(), ==, 3);
+  g_assert_cmpuint(hunks[0].old_start, ==, 1);
+  g_assert_cmpuint(hunks[0].old_count, ==, 1);
+  g_assert_cmpuint(hunks[0].new_count, ==, 1);
+  g_assert_cmpuint(hunks[1].old_start, ==, 3);
+  g_assert_cmpuint(hunks[1].old_count, ==, 1);
+  g_assert_cmpuint(hunks[1].new_start, ==, 3);
+  g_assert_cmpuint(hunks[1].new_count, ==, 2);
+  g_assert_cmpuint(hunks[2].old_count, ==, 0);
+  g_assert_cmpuint(hunks[2].new_start, ==, 6);
+  assert_valid(old_lines, new_lines, hunks);
+}
+
+static void test_edit_moves_later_hunks() {
+  const std::u16string head = u"a\nb\nc\nd\ne\nf";
+  std::u16string text = u"a\nb\nc\nd\ne\nF";
+  const std::vector<std::u16string> old_lines = split_lines(head);
+  std::vector<std::u16string> new_lines = split_lines(text);
+  LineDiff diff;
+  diff.set_hunks(diff_lines(old_lines.data(), old_lines.size(), new_lines.data(), new_lines.size()));
+  // two new lines after the first line only move the hunk at the end
+  diff.add_change(edit(text, 1, 1, u"\nx\ny"));
+  new_lines = split_lines(text);
+  const std::vector<LineHunk> &hunks = diff.get_hunks();
+  g_assert_cmpuint(hunks.size(), ==, 2);
+  g_assert_true(hunks[0].dirty);
+  g_assert_false(hunks[1].dirty);
+  g_assert_cmpuint(hunks[1].new_start, ==, 7);
+  size_t lines_read = 0;
+  diff.update(old_lines, [&](size_t row) {
+    lines_read++;
+    return new_lines[row];
+  });
+  g_assert_cmpuint(lines_read, ==, 3);
+  assert_valid(old_lines, new_lines, diff.get_hunks());
+  g_assert_cmpuint(diff.get_hunks()[0].old_count, ==, 0);
+  g_assert_cmpuint(diff.get_hunks()[0].new_count, ==, 2);
+}
+
+static void test_too_many_changes() {
+  std::u16string text = u"a\nb";
+  LineDiff diff;
+  diff.set_hunks({});
+  for (int i = 0; i < 1000; i++) {
+    diff.add_change(edit(text, 0, 0, u"x"));
+  }
+  g_assert_false(diff.is_valid());
+}
+
+static void test_random_edits() {
+  static const char16_t *pieces[] = {u"a", u"b", u"c", u"\n", u"\n"};
+  GRand *rand = g_rand_new_with_seed(42);
+  auto random_text = [&](int length) {
+    std::u16string text;
+    for (int i = 0; i < length; i++) {
+      text.append(pieces[g_rand_int_range(rand, 0, G_N_ELEMENTS(pieces))]);
+    }
+    return text;
+  };
+  for (int iteration = 0; iteration < 2000; iteration++) {
+    std::u16string text = random_text(40);
+    const std::vector<std::u16string> old_lines = split_lines(text);
+    LineDiff diff;
+    diff.set_hunks({});
+    for (int round = 0; round < 5; round++) {
+      const int edit_count = g_rand_int_range(rand, 0, 6);
+      for (int i = 0; i < edit_count; i++) {
+        const size_t start = g_rand_int_range(rand, 0, text.size() + 1);
+        const size_t end = start + g_rand_int_range(rand, 0, std::min<size_t>(text.size() - start, 6) + 1);
+        diff.add_change(edit(text, start, end, random_text(g_rand_int_range(rand, 0, 5))));
+      }
+      const std::vector<std::u16string> new_lines = split_lines(text);
+      diff.update(old_lines, [&](size_t row) {
+        return new_lines.at(row);
+      });
+      assert_valid(old_lines, new_lines, diff.get_hunks());
+    }
+  }
+  g_rand_free(rand);
+}
+
+int main(int argc, char **argv) {
+  g_test_init(&argc, &argv, NULL);
+  g_test_add_func("/line-diff/diff-lines", test_diff_lines);
+  g_test_add_func("/line-diff/edit-moves-later-hunks", test_edit_moves_later_hunks);
+  g_test_add_func("/line-diff/too-many-changes", test_too_many_changes);
+  g_test_add_func("/line-diff/random-edits", test_random_edits);
+  return g_test_run();
+}
@@ -0,0 +1,55 @@
+#include "multi-cursor-edit.h"
+#include <text-editor.h>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// types at 1 to 100k cursors, once through the batched path and once through
+// TextEditor::insertText, which goes through the whole insertText of every selection
+#define KEYSTROKES 10
+#define MAX_PER_SELECTION_CURSORS 10000
+
+static TextEditor *create_text_editor(size_t cursor_count) {
+  std::u16string text;
+  for (size_t row = 0; row < cursor_count; row++) {
+    text.append(u"    value = compute(value);\n");
+  }
+  TextBuffer *buffer = new TextBuffer();
+  buffer->setText(text);
+  TextEditor *text_editor = new TextEditor(buffer);
+  std::vector<Range> ranges;
+  for (size_t row = 0; row < cursor_count; row++) {
+    ranges.push_back(Range(Point(row, 4), Point(row, 4)));
+  }
+  text_editor->setSelectedBufferRanges(ranges);
+  return text_editor;
+}
+
+// the average time of one keystroke in milliseconds
+template <class F> static double measure(size_t cursor_count, F f) {
+  TextEditor *text_editor = create_text_editor(cursor_count);
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < KEYSTROKES; i++) {
+    f(text_editor);
+  }
+  const auto end = std::chrono::steady_clock::now();
+  delete text_editor;
+  return std::chrono::duration<double, std::milli>(end - start).count() / KEYSTROKES;
+}
+
+int main() {
+  for (size_t cursor_count = 1; cursor_count <= 100000; cursor_count *= 10) {
+    const double batched = measure(cursor_count, [](TextEditor *text_editor) {
+      insert_text_at_selections(text_editor, u"x");
+    });
+    if (cursor_count > MAX_PER_SELECTION_CURSORS) {
+      printf("%6zu cursors: %10.3f ms batched\n", cursor_count, batched);
+      continue;
+    }
+    const double per_selection = measure(cursor_count, [](TextEditor *text_editor) {
+      text_editor->insertText(u"x");
+    });
+    printf("%6zu cursors: %10.3f ms batched, %10.3f ms per selection\n", cursor_count, batched, per_selection);
+  }
+  return 0;
+}
@@ -0,0 +1,60 @@
+#include "occurrence-index.h"
+#include <text-buffer.h>
+#include <chrono>
+#include <cstdio>
+
+// select-next over a buffer with 100k occurrences of the selected word: building the
+// index, pressing select-next, and updating the index after an edit
+#define OCCURRENCE_COUNT 100000
+#define PRESSES 1000
+#define EDITS 100
+
+template <class F> static double measure(int count, F f) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < count; i++) {
+    f(i);
+  }
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() / count;
+}
+
+int main() {
+  std::u16string text;
+  for (int row = 0; row < OCCURRENCE_COUNT; row++) {
+    text.append(u"  value = compute(other);\n");
+  }
+  TextBuffer *buffer = new TextBuffer();
+  buffer->setText(text);
+  OccurrenceIndex occurrences;
+  const double build = measure(1, [&](int) {
+    occurrences.update(buffer, u"value", true);
+  });
+  std::printf("build index:        %10.3f ms\n", build);
+
+  occurrences.set_selection({Range(Point(0, 2), Point(0, 7))});
+  Point position(0, 7);
+  const double press = measure(PRESSES, [&](int) {
+    const std::vector<Range> &ranges = occurrences.update(buffer, u"value", true);
+    const size_t index = occurrences.find_unselected(position);
+    occurrences.select(index);
+    position = ranges[index].end;
+  });
+  std::printf("select next:        %10.3f ms\n", press);
+
+  const double edit = measure(EDITS, [&](int i) {
+    // rename one occurrence in the middle of the buffer and update the index
+    const Range old_range(Point(OCCURRENCE_COUNT / 2 + i, 2), Point(OCCURRENCE_COUNT / 2 + i, 7));
+    const Range new_range = buffer->setTextInRange(old_range, u"val");
+    occurrences.add_change(BufferChange{old_range, new_range});
+    occurrences.update(buffer, u"value", true);
+  });
+  std::printf("edit and update:    %10.3f ms\n", edit);
+
+  const double rebuild = measure(EDITS, [&](int) {
+    OccurrenceIndex fresh;
+    fresh.update(buffer, u"value", true);
+  });
+  std::printf("full search:        %10.3f ms\n", rebuild);
+  delete buffer;
+  return 0;
+}
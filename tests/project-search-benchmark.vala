@@ -0,0 +1,73 @@
+// searches a generated tree of 100 directories with 100 files each, with matches
+// in ASCII and non-ASCII text and a few files that are not valid UTF-8
+const int DIRECTORY_COUNT = 100;
+const int FILE_COUNT = 100;
+const int LINE_COUNT = 200;
+
+void generate_tree(string root) throws Error {
+  for (int d = 0; d < DIRECTORY_COUNT; d++) {
+    string directory = Path.build_filename(root, "directory-%d".printf(d));
+    DirUtils.create(directory, 0755);
+    for (int f = 0; f < FILE_COUNT; f++) {
+      var builder = new StringBuilder();
+      for (int row = 0; row < LINE_COUNT; row++) {
+        if (row % 50 == 0) {
+          builder.append("  const String ÜBERSCHRIFT = \"Größe\"; // TODO\n");
+        } else {
+          builder.append("  int value%d = compute(value%d, %d);\n".printf(row, row - 1, f));
+        }
+      }
+      if (f == 0) {
+        // a Latin-1 encoded line
+        builder.append_c((char)0xFC);
+        builder.append("berschrift todo\n");
+      }
+      FileUtils.set_contents(Path.build_filename(directory, "file-%d.c".printf(f)), builder.str);
+    }
+  }
+}
+
+void remove_tree(File file) throws Error {
+  if (file.query_file_type(FileQueryInfoFlags.NOFOLLOW_SYMLINKS) == FileType.DIRECTORY) {
+    var enumerator = file.enumerate_children(FileAttribute.STANDARD_NAME, FileQueryInfoFlags.NOFOLLOW_SYMLINKS);
+    FileInfo? info;
+    while ((info = enumerator.next_file()) != null) {
+      remove_tree(file.get_child(info.get_name()));
+    }
+  }
+  file.delete();
+}
+
+void measure(File root, string pattern, bool use_regex, bool case_sensitive) throws Error {
+  var search = new Atom.ProjectSearch(pattern, use_regex, case_sensitive);
+  var loop = new MainLoop();
+  int result_count = 0;
+  search.results_found.connect((results) => {
+    result_count += results.length;
+  });
+  search.finished.connect((truncated) => {
+    loop.quit();
+  });
+  var timer = new Timer();
+  search.start(root);
+  loop.run();
+  stdout.printf("%-24s %8d results %10.1f ms\n", pattern, result_count, timer.elapsed() * 1000);
+}
+
+int main() {
+  try {
+    string root = DirUtils.make_tmp("project-search-XXXXXX");
+    generate_tree(root);
+    var file = File.new_for_path(root);
+    measure(file, "todo", false, false);
+    measure(file, "größe", false, false);
+    measure(file, "überschrift", false, false);
+    measure(file, "value\\d+ = compute", true, true);
+    measure(file, "no match at all", false, true);
+    remove_tree(file);
+  } catch (Error e) {
+    stderr.printf("%s\n", e.message);
+    return 1;
+  }
+  return 0;
+}